@@ -7,6 +7,11 @@
 #include "tdzdd_apps.hpp"
 #include "converter.hpp"
 #include "optimization.hpp"
+#include "flat_diagram.hpp"
+#include "semiring.hpp"
+#include "sampling.hpp"
+#include "persistence.hpp"
+#include "instance_loader.hpp"
 
 namespace sapporo_tdzdd_apps {
 
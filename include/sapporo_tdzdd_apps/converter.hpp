@@ -1,26 +1,107 @@
 #ifndef SAPPORO_TDZDD_APPS_CONVERTER_HPP
 #define SAPPORO_TDZDD_APPS_CONVERTER_HPP
 
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
 #include <tdzdd/spec/SapporoZdd.hpp>
-#include <tdzdd/eval/ToZBDD.hpp>
 #include <tdzdd/DdStructure.hpp>
+#include <tdzdd/dd/NodeTable.hpp>
+#include "for_sapporo/memory_manager.hpp"
 
 namespace sapporo_tdzdd_apps {
 
 /*****
  * to_ddstructure(zbdd)
  *      Convert ZBDD to DdStructure.
+ *      The nodes of zbdd are numbered level by level through a map from
+ *      node ID to NodeId and copied into the node table directly,
+ *      without building through a spec. Assume that variable i of
+ *      SAPPOROBDD is at level i (see check_sapporo_vars).
  *****/
 tdzdd::DdStructure<2> to_ddstructure(const ZBDD& zbdd) {
-    return tdzdd::DdStructure<2>(tdzdd::SapporoZdd(zbdd));
+    typedef std::pair<bddword, bddword> Children;
+    int n = zbdd.Top();
+    std::unordered_map<bddword, tdzdd::NodeId> id_map;
+    std::vector<std::vector<Children>> rows(n + 1);
+    id_map[ZBDD(0).GetID()] = tdzdd::NodeId(0, 0);
+    id_map[ZBDD(1).GetID()] = tdzdd::NodeId(0, 1);
+
+    // number the nodes
+    std::vector<ZBDD> stack(1, zbdd);
+    while (not stack.empty()) {
+        ZBDD f = stack.back();
+        stack.pop_back();
+        if (id_map.count(f.GetID()) == 1) continue;
+        int i = f.Top();
+        ZBDD f0 = f.OffSet(i), f1 = f.OnSet0(i);
+        id_map[f.GetID()] = tdzdd::NodeId(i, rows[i].size());
+        rows[i].push_back(Children(f0.GetID(), f1.GetID()));
+        stack.push_back(f0);
+        stack.push_back(f1);
+    }
+
+    // copy them into the node table
+    tdzdd::DdStructure<2> dd;
+    dd.getDiagram().init(n + 1);
+    tdzdd::NodeTableEntity<2>& table = dd.getDiagram().privateEntity();
+    for (int i = 1; i <= n; ++i) {
+        table.initRow(i, rows[i].size());
+        for (size_t j = 0; j < rows[i].size(); ++j) {
+            table[i][j].branch[0] = id_map[rows[i][j].first];
+            table[i][j].branch[1] = id_map[rows[i][j].second];
+        }
+        std::vector<Children>().swap(rows[i]);
+    }
+    dd.root() = id_map[zbdd.GetID()];
+    return dd;
 }
 
 /*****
  * to_zbdd(dd)
  *      Convert DdStructure to ZBDD.
+ *      Levels are converted bottom-up, and the ZBDDs of a level are
+ *      released right after the highest level referring to it,
+ *      so only the levels still referred to are kept alive.
  *****/
 ZBDD to_zbdd(const tdzdd::DdStructure<2>& dd) {
-    return dd.evaluate(tdzdd::ToZBDD());
+    const tdzdd::NodeTableEntity<2>& diagram = *dd.getDiagram();
+    int n = dd.topLevel();
+    // Change and + create at most two nodes per DD node
+    SapporoMemoryManager::instance().reserve(2 * dd.size(), "to_zbdd");
+
+    // release[i] lists the levels whose last parent is at level i
+    std::vector<int> last_use(n + 1, 0);
+    for (int i = 1; i <= n; ++i) {
+        int w = diagram[i].size();
+        for (int j = 0; j < w; ++j) {
+            for (int b = 0; b < 2; ++b) {
+                int r = diagram.child(i, j, b).row();
+                last_use[r] = std::max(last_use[r], i);
+            }
+        }
+    }
+    std::vector<std::vector<int>> release(n + 1);
+    for (int r = 1; r < n; ++r) release[last_use[r]].push_back(r);
+
+    std::vector<std::vector<ZBDD>> z(n + 1);
+    z[0] = {ZBDD(0), ZBDD(1)};
+    for (int i = 1; i <= n; ++i) {
+        int w = diagram[i].size();
+        z[i].resize(w);
+        for (int j = 0; j < w; ++j) {
+            tdzdd::NodeId f0 = diagram.child(i, j, 0);
+            tdzdd::NodeId f1 = diagram.child(i, j, 1);
+            z[i][j] = z[f0.row()][f0.col()]
+                      + z[f1.row()][f1.col()].Change(i);
+        }
+        for (int r : release[i]) std::vector<ZBDD>().swap(z[r]);
+    }
+
+    SapporoMemoryManager::instance().record();
+    tdzdd::NodeId root = dd.root();
+    return z[root.row()][root.col()];
 }
 
 } // namespace sapporo_tdzdd_apps
@@ -0,0 +1,160 @@
+#ifndef SAPPORO_TDZDD_APPS_FLAT_DIAGRAM_HPP
+#define SAPPORO_TDZDD_APPS_FLAT_DIAGRAM_HPP
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <tdzdd/DdStructure.hpp>
+#include <tdzdd/dd/NodeTable.hpp>
+
+namespace sapporo_tdzdd_apps {
+
+/*****
+ * class FlatDiagram
+ *      Flat copy of the node table of a DdStructure.
+ *      Nodes are numbered level by level from the bottom:
+ *      0 and 1 are the terminals, and the nodes of level i are
+ *      [level_begin(i), level_end(i)). The two children of node v
+ *      are stored next to each other as 32-bit indices, so a bottom-up
+ *      pass reads one contiguous array per level.
+ *      Level i corresponds to item top_level() - i,
+ *      as in unfold_ddstructure.
+ *      The arrays are immutable and shared by copies; they are owned
+ *      either by the FlatDiagram itself or by a mapped file
+ *      (see load_diagram in persistence.hpp).
+ *****/
+class FlatDiagram {
+private:
+    struct Storage {
+        std::vector<uint64_t> offset;
+        std::vector<uint32_t> children;
+    };
+
+    int n;
+    uint32_t root_index;
+    std::shared_ptr<const void> owner;
+    const uint64_t* offset;
+    const uint32_t* children;
+
+    void adopt(std::shared_ptr<Storage> st) {
+        offset = st->offset.data();
+        children = st->children.data();
+        owner = st;
+    }
+
+public:
+    FlatDiagram() : n(0), root_index(0) {
+        auto st = std::make_shared<Storage>();
+        st->offset = {0, 2};
+        st->children.assign(4, 0);
+        adopt(st);
+    }
+
+    explicit FlatDiagram(const tdzdd::DdStructure<2>& dd) {
+        const tdzdd::NodeTableEntity<2>& diagram = *dd.getDiagram();
+        n = dd.topLevel();
+        auto st = std::make_shared<Storage>();
+        st->offset.assign(n + 2, 0);
+        st->offset[1] = 2;
+        for (int i = 1; i <= n; ++i) {
+            st->offset[i + 1] = st->offset[i] + diagram[i].size();
+        }
+        assert(st->offset[n + 1] <= std::numeric_limits<uint32_t>::max());
+
+        auto index_of = [&](tdzdd::NodeId f) -> uint32_t {
+            return (f.row() == 0 ? f.col() : st->offset[f.row()] + f.col());
+        };
+        st->children.assign(2 * st->offset[n + 1], 0);
+        for (int i = 1; i <= n; ++i) {
+            int w = diagram[i].size();
+            for (int j = 0; j < w; ++j) {
+                for (int b = 0; b < 2; ++b) {
+                    tdzdd::NodeId f = diagram.child(i, j, b);
+                    st->children[2 * (st->offset[i] + j) + b] = index_of(f);
+                }
+            }
+        }
+        root_index = index_of(dd.root());
+        adopt(st);
+    }
+
+    /*****
+     * FlatDiagram(n, root, owner, offset, children)
+     *      View arrays owned by owner (offset has n + 2 entries,
+     *      children has 2 * offset[n + 1]) without copying.
+     *****/
+    FlatDiagram(
+        int n,
+        uint32_t root,
+        std::shared_ptr<const void> owner,
+        const uint64_t* offset,
+        const uint32_t* children
+    ) : n(n), root_index(root), owner(owner),
+        offset(offset), children(children) {}
+
+    int top_level() const { return n; }
+    size_t size() const { return offset[n + 1]; }
+    size_t level_begin(int i) const { return offset[i]; }
+    size_t level_end(int i) const { return offset[i + 1]; }
+    uint32_t root() const { return root_index; }
+    uint32_t child(size_t v, int b) const { return children[2 * v + b]; }
+    const uint64_t* offset_array() const { return offset; }
+    const uint32_t* child_array() const { return children; }
+
+    int level_of(size_t v) const {
+        if (v < 2) return 0;
+        return std::upper_bound(offset, offset + n + 2, (uint64_t)v)
+               - offset - 1;
+    }
+};
+
+/*****
+ * visit_flat_diagram(n_vars, fd, visitor)
+ *      Same as visit_ddstructure for a FlatDiagram.
+ *****/
+template<typename Visitor>
+bool visit_flat_diagram(int n_vars, const FlatDiagram& fd, Visitor visitor) {
+    std::vector<int> ans;
+    ans.reserve(n_vars);
+
+    std::function<bool(size_t)> dfs = [&](size_t v) {
+        if (v < 2) {
+            if (v == 0) return true;
+            return (bool)visitor((const std::vector<int>&)ans);
+        }
+        if (not dfs(fd.child(v, 0))) return false;
+        ans.push_back(n_vars - fd.level_of(v));
+        bool cont = dfs(fd.child(v, 1));
+        ans.pop_back();
+        return cont;
+    };
+
+    return dfs(fd.root());
+}
+
+/*****
+ * unfold_flat_diagram(n_vars, fd, sorted)
+ *      Same as unfold_ddstructure for a FlatDiagram.
+ *****/
+std::vector<std::vector<int>> unfold_flat_diagram(
+    int n_vars,
+    const FlatDiagram& fd,
+    bool sorted = false
+) {
+    std::vector<std::vector<int>> answer_set;
+    visit_flat_diagram(n_vars, fd, [&](const std::vector<int>& ans) {
+        answer_set.push_back(ans);
+        return true;
+    });
+    if (sorted) std::sort(answer_set.begin(), answer_set.end());
+    return answer_set;
+}
+
+} // namespace sapporo_tdzdd_apps
+
+#endif
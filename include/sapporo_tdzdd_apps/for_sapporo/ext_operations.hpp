@@ -2,13 +2,17 @@
 #define SAPPORO_TDZDD_APPS_EXT_OPERATIONS_HPP
 
 #include "ZBDD.h"
+#include "memory_manager.hpp"
 
 namespace sapporo_tdzdd_apps {
 
 /*****
  * check_sapporo_vars(n)
+ *      Create variables up to n. SAPPOROBDD must have been set up
+ *      through SapporoMemoryManager (init or attach).
  *****/
 void check_sapporo_vars(int n) {
+    SapporoMemoryManager::instance().require("check_sapporo_vars");
     while (BDD_VarUsed() < n) BDD_NewVar();
 }
 
@@ -0,0 +1,141 @@
+#ifndef SAPPORO_TDZDD_APPS_MEMORY_MANAGER_HPP
+#define SAPPORO_TDZDD_APPS_MEMORY_MANAGER_HPP
+
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <cstddef>
+#include "ZBDD.h"
+
+namespace sapporo_tdzdd_apps {
+
+/*****
+ * class SapporoMemoryManager
+ *      Size the SAPPOROBDD node table and guard it by a node budget.
+ *      Use SapporoMemoryManager::instance().init(...) instead of bddinit,
+ *      or call attach(limit_nodes) after bddinit(_, limit_nodes); the
+ *      manager never runs bddinit on a table it did not create, and the
+ *      functions that create ZBDD nodes throw std::runtime_error if
+ *      neither init nor attach has been called.
+ *      Before an operation that creates ZBDD nodes (to_zbdd,
+ *      LinearOptimization::optimize), reserve(nodes, what) is called with
+ *      an upper bound estimated from the DdStructure: it runs GC when the
+ *      estimate does not fit in the rest of the budget, and throws
+ *      std::runtime_error if it still does not fit, instead of
+ *      overflowing the node table partway.
+ *      record() after such an operation updates the peak node count.
+ *
+ * void init(bddword limit_nodes, bddword init_nodes=DEFAULT_INIT_NODES)
+ *      Initialize SAPPOROBDD with at most limit_nodes nodes.
+ *
+ * void init_with_budget(size_t bytes)
+ *      Initialize SAPPOROBDD so that its node table fits in bytes
+ *      (BYTES_PER_NODE bytes per node, approximately).
+ *
+ * bool is_initialized() const
+ *      Check whether init or attach has been called.
+ *
+ * void attach(bddword limit_nodes)
+ *      Manage a SAPPOROBDD already initialized by bddinit(_, limit_nodes).
+ *
+ * void require(const std::string& what) const
+ *      Throw std::runtime_error naming what if neither init nor attach
+ *      has been called.
+ *
+ * void reserve(bddword nodes, const std::string& what)
+ *      Make sure that nodes more nodes can be created (after require).
+ *
+ * void record()
+ *      Update the peak with the current number of nodes in use.
+ *
+ * void gc()
+ *      Record the peak and run garbage collection.
+ *
+ * bddword peak_nodes() const / bddword limit_nodes() const
+ *      Get the peak node count seen by record() and the node limit.
+ *****/
+class SapporoMemoryManager {
+private:
+    bool initialized;
+    bddword limit;
+    bddword peak;
+
+    SapporoMemoryManager() : initialized(false), limit(0), peak(0) {}
+
+public:
+    static constexpr bddword DEFAULT_INIT_NODES = 1 << 16;
+    static constexpr size_t BYTES_PER_NODE = 32;
+
+    static SapporoMemoryManager& instance() {
+        static SapporoMemoryManager manager;
+        return manager;
+    }
+
+    void init(bddword limit_nodes, bddword init_nodes = DEFAULT_INIT_NODES) {
+        init_nodes = std::min(init_nodes, limit_nodes);
+        if (bddinit(init_nodes, limit_nodes) != 0) {
+            throw std::runtime_error(
+                "SAPPOROBDD: cannot initialize a node table of "
+                + std::to_string(limit_nodes) + " nodes");
+        }
+        initialized = true;
+        limit = limit_nodes;
+        peak = 0;
+    }
+
+    void attach(bddword limit_nodes) {
+        initialized = true;
+        limit = limit_nodes;
+        peak = 0;
+    }
+
+    void init_with_budget(size_t bytes) {
+        init(bytes / BYTES_PER_NODE);
+    }
+
+    bool is_initialized() const {
+        return initialized;
+    }
+
+    void require(const std::string& what) const {
+        if (initialized) return;
+        throw std::runtime_error(
+            what + ": SAPPOROBDD is not managed; call "
+            "SapporoMemoryManager::instance().init(...), "
+            "or attach(limit_nodes) after bddinit");
+    }
+
+    void reserve(bddword nodes, const std::string& what) {
+        require(what);
+        record();
+        if (bddused() + nodes <= limit) return;
+        gc();
+        if (bddused() + nodes <= limit) return;
+        throw std::runtime_error(
+            what + ": needs up to " + std::to_string(nodes)
+            + " SAPPOROBDD nodes, but only "
+            + std::to_string(limit - std::min(limit, bddused()))
+            + " of " + std::to_string(limit) + " are left");
+    }
+
+    void record() {
+        peak = std::max(peak, bddused());
+    }
+
+    void gc() {
+        record();
+        bddgc();
+    }
+
+    bddword peak_nodes() const {
+        return peak;
+    }
+
+    bddword limit_nodes() const {
+        return limit;
+    }
+};
+
+} // namespace sapporo_tdzdd_apps
+
+#endif
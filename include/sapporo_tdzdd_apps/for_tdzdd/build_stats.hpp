@@ -0,0 +1,128 @@
+#ifndef SAPPORO_TDZDD_APPS_BUILD_STATS_HPP
+#define SAPPORO_TDZDD_APPS_BUILD_STATS_HPP
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <ostream>
+#include <set>
+#include <cstddef>
+#include <tdzdd/DdStructure.hpp>
+#include <tdzdd/dd/Node.hpp>
+#include <tdzdd/dd/NodeTable.hpp>
+#include "graph_data.hpp"
+
+namespace sapporo_tdzdd_apps {
+
+/*****
+ * struct BuildStats
+ *      Statistics of one build_reduced_dd call, filled in when a pointer
+ *      to it is passed to a tdzdd_* function. Recording costs two clock
+ *      reads and O(levels + items) work, so it can stay on.
+ *      Widths are indexed by level as in TdZdd; level 0 holds the
+ *      terminals, so the totals agree with DdStructure::size().
+ *
+ * std::vector<size_t> unreduced_width, reduced_width
+ *      Number of nodes of each level before and after zddReduce.
+ *
+ * size_t state_bytes
+ *      Size of the spec state of one node (DdSpec::datasize).
+ *
+ * double construction_sec, reduction_sec
+ *      Wall time of the top-down construction and of zddReduce.
+ *
+ * size_t est_peak_table_bytes
+ *      Estimate of the node table memory while zddReduce runs, when both
+ *      the unreduced and the reduced tables are alive: node count times
+ *      sizeof(Node<2>). Spec states, hash tables and allocator slack of
+ *      the construction are not counted; measure the process peak (e.g.
+ *      VmHWM) for those.
+ *
+ * std::vector<int> frontier_size
+ *      frontier_size[k] is the number of vertices on the frontier while
+ *      item k of G is processed (empty if the builder takes no Graph).
+ *
+ * size_t unreduced_nodes() const / size_t reduced_nodes() const
+ *      Total widths.
+ *
+ * void write_json(std::ostream& os) const / std::string to_json() const
+ *      Write the statistics as one JSON object.
+ *****/
+struct BuildStats {
+    std::vector<size_t> unreduced_width;
+    std::vector<size_t> reduced_width;
+    size_t state_bytes = 0;
+    double construction_sec = 0;
+    double reduction_sec = 0;
+    size_t est_peak_table_bytes = 0;
+    std::vector<int> frontier_size;
+
+    size_t unreduced_nodes() const {
+        size_t total = 0;
+        for (size_t w : unreduced_width) total += w;
+        return total;
+    }
+
+    size_t reduced_nodes() const {
+        size_t total = 0;
+        for (size_t w : reduced_width) total += w;
+        return total;
+    }
+
+    // record the level widths of dd into width
+    static void record_widths(
+        const tdzdd::DdStructure<2>& dd,
+        std::vector<size_t>& width
+    ) {
+        const tdzdd::NodeTableEntity<2>& diagram = *dd.getDiagram();
+        int n = diagram.numRows() - 1;
+        width.assign(n + 1, 0);
+        for (int i = 0; i <= n; ++i) width[i] = diagram[i].size();
+    }
+
+    // frontier size of each item of G (after G.setup())
+    void record_frontier(const Graph& G) {
+        std::set<int> frontier;
+        frontier_size.assign(G.n_items(), 0);
+        for (int k = 0; k < G.n_items(); ++k) {
+            if (G.is_vertex(k)) {
+                frontier_size[k] = frontier.size();
+                frontier.erase(G.item_v0(k));
+            } else {
+                frontier.insert(G.item_v0(k));
+                frontier.insert(G.item_v1(k));
+                frontier_size[k] = frontier.size();
+            }
+        }
+    }
+
+    void write_json(std::ostream& os) const {
+        auto write_array = [&](const char* key, const auto& v) {
+            os << "\"" << key << "\":[";
+            for (size_t k = 0; k < v.size(); ++k) os << (k ? "," : "") << v[k];
+            os << "]";
+        };
+        os << "{\"construction_sec\":" << construction_sec
+           << ",\"reduction_sec\":" << reduction_sec
+           << ",\"state_bytes\":" << state_bytes
+           << ",\"est_peak_table_bytes\":" << est_peak_table_bytes
+           << ",\"unreduced_nodes\":" << unreduced_nodes()
+           << ",\"reduced_nodes\":" << reduced_nodes() << ",";
+        write_array("unreduced_width", unreduced_width);
+        os << ",";
+        write_array("reduced_width", reduced_width);
+        os << ",";
+        write_array("frontier_size", frontier_size);
+        os << "}";
+    }
+
+    std::string to_json() const {
+        std::ostringstream os;
+        write_json(os);
+        return os.str();
+    }
+};
+
+} // namespace sapporo_tdzdd_apps
+
+#endif
@@ -2,14 +2,23 @@
 #define SAPPORO_TDZDD_APPS_COMPONENT_SPEC_HPP
 
 #include <algorithm>
+#include <utility>
+#include <limits>
+#include <cassert>
 #include <tdzdd/DdSpec.hpp>
 #include "graph_data.hpp"
 
 namespace sapporo_tdzdd_apps {
 
 /*****
- * class ComponentSpecBase
+ * class ComponentSpecBase<T>
+ *      mate[i] is the component label of the vertex at frontier index i
+ *      (INIT if no edge of the vertex is taken yet).
+ *      The label of a component is the smallest frontier index in it,
+ *      so labels are canonical without renumbering.
+ *      T must hold every value in [0, max_frontier_size()].
  *****/
+template<typename T>
 class ComponentSpecBase {
 protected:
     const Graph& G;
@@ -17,45 +26,39 @@ protected:
     const bool non_cyclic;
     const bool with_vertex;
     
-    const int INIT = -1;
+    const T INIT = std::numeric_limits<T>::max();
 
-    int entry(int* mate, int v) const {
+    int entry(T* mate, int v) const {
         int i = G.frontier_index(v);
-        if (mate[i] == INIT) mate[i] = *std::max_element(mate, mate + F) + 1;
+        if (mate[i] == INIT) mate[i] = i;
         return i;
     }
 
-    void translation(int* mate) const {
-        int c = 0;
-        std::vector<int> trans(F + 1, -1);
-        for (int i = 0; i < F; ++i) {
-            int mi = mate[i];
-            if (mi == INIT) continue;
-            if (trans[mi] == -1) trans[mi] = mate[i] = c++;
-            else mate[i] = trans[mi];
-        }
-    }
-
-    void connect(int* mate, int ui, int vi) const {
+    void connect(T* mate, int ui, int vi) const {
         int a = mate[ui], b = mate[vi];
-        for (int i = 0; i < F; ++i) if (mate[i] == a) mate[i] = b;
-        translation(mate);
+        if (a == b) return;
+        if (a > b) std::swap(a, b);
+        // every member of component b is at index b or later
+        for (int i = b; i < F; ++i) if ((int)mate[i] == b) mate[i] = a;
     }
 
-    bool is_independent(int* mate, int i) const {
-        if (mate[i] == INIT) return false;
-        for (int j = 0; j < F; ++j) {
-            if (j == i) continue;
-            if (mate[i] == mate[j]) return false;
+    // remove i from the frontier, and return true
+    // if i was the last vertex of its component on the frontier
+    bool leave(T* mate, int i) const {
+        int c = mate[i];
+        mate[i] = INIT;
+        if (c != i) return false;
+        int r = -1;
+        for (int j = i + 1; j < F; ++j) {
+            if ((int)mate[j] != c) continue;
+            if (r == -1) r = j;
+            mate[j] = r;
         }
-        return true;
+        return r == -1;
     }
 
-    bool find_other_component(int* mate, int c) const {
-        for (int i = 0; i < F; ++i) {
-            if (mate[i] == INIT) continue;
-            if (mate[i] != c) return true; 
-        }
+    bool find_other_component(T* mate) const {
+        for (int i = 0; i < F; ++i) if (mate[i] != INIT) return true;
         return false;
     }
 
@@ -65,53 +68,64 @@ public:
         bool non_cyclic,
         bool with_vertex
     ) : G(G), F(G.max_frontier_size()),
-        non_cyclic(non_cyclic), with_vertex(with_vertex) {}
+        non_cyclic(non_cyclic), with_vertex(with_vertex)
+    {
+        assert(F <= (long long)std::numeric_limits<T>::max());
+    }
 };
 
 /*****
- * class ConnectedSpec
+ * class ConnectedSpec<T=int>
  *****/
+template<typename T = int>
 class ConnectedSpec :
-    public tdzdd::PodArrayDdSpec<ConnectedSpec, int, 2>,
-    public ComponentSpecBase {
+    public tdzdd::PodArrayDdSpec<ConnectedSpec<T>, T, 2>,
+    public ComponentSpecBase<T> {
+private:
+    typedef ComponentSpecBase<T> Base;
+    using Base::G;
+    using Base::F;
+    using Base::non_cyclic;
+    using Base::with_vertex;
+    using Base::INIT;
+
 public:
     ConnectedSpec(
         const Graph& G,
         bool non_cyclic = false,
         bool with_vertex = false
-    ) : ComponentSpecBase(G, non_cyclic, with_vertex)
+    ) : Base(G, non_cyclic, with_vertex)
     {
-        setArraySize(F);
+        this->setArraySize(F);
     }
 
-    int getRoot(int* mate) const {
+    int getRoot(T* mate) const {
         for (int i = 0; i < F; ++i) mate[i] = INIT;
         return G.n_items();
     }
 
-    int getChild(int* mate, int level, bool take) const {
+    int getChild(T* mate, int level, bool take) const {
         int i = G.n_items() - level;
 
         if (G.is_vertex(i)) {
             if (take and not with_vertex) return 0;
-            // G[i][0] leaves frontier
-            int vi = G.frontier_index(G[i][0]);
+            // the vertex of item i leaves frontier
+            int vi = G.frontier_index(G.item_v0(i));
             if (with_vertex) {
                 if (not take and mate[vi] != INIT) return 0;
                 if (take and mate[vi] == INIT) return 0;
             }
             // check component
-            if (is_independent(mate, vi)) {
-                if (find_other_component(mate, mate[vi])) return 0;
+            if (mate[vi] != INIT and this->leave(mate, vi)) {
+                if (this->find_other_component(mate)) return 0;
                 return -1; // complete
             }
-            mate[vi] = INIT;
         }
         else if (take) {
-            int u = G[i][0], v = G[i][1];
-            int ui = entry(mate, u), vi = entry(mate, v);
+            int u = G.item_v0(i), v = G.item_v1(i);
+            int ui = this->entry(mate, u), vi = this->entry(mate, v);
             if (non_cyclic and mate[ui] == mate[vi]) return 0; // cyclic
-            connect(mate, ui, vi);
+            this->connect(mate, ui, vi);
         }
 
         return level - 1;
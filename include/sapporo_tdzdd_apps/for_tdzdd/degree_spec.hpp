@@ -4,42 +4,79 @@
 #include <vector>
 #include <set>
 #include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <cassert>
 #include <tdzdd/DdSpec.hpp>
 #include "graph_data.hpp"
+#include "flag_array.hpp"
 
 namespace sapporo_tdzdd_apps {
 
 /*****
- * class RangeDegreeSpec
+ * make_remaining_degree_table(G)
+ *      Return rest with rest[2 * i + j] = the number of edges of
+ *      the j'th vertex of edge item i (item_v0 or item_v1)
+ *      that come after item i. Entries of vertex items are 0.
+ *      Note that this function takes O(|V| + |E|) time.
  *****/
+std::vector<int> make_remaining_degree_table(const Graph& G) {
+    std::vector<int> count(G.max_vertex_number() + 1, 0);
+    std::vector<int> rest(2 * G.n_items(), 0);
+    for (int i = G.n_items() - 1; i >= 0; --i) {
+        if (G.is_vertex(i)) continue;
+        int u = G.item_v0(i), v = G.item_v1(i);
+        rest[2 * i] = count[u]++;
+        rest[2 * i + 1] = count[v]++;
+    }
+    return rest;
+}
+
+/*****
+ * class RangeDegreeSpec<T=int>
+ *      The top bit of mate[i] is TAKE_FLAG and the other bits
+ *      hold the degree (COMPLETE once the constraint is decided).
+ *      For each endpoint of each edge item, the frontier index,
+ *      the bounds and the number of its remaining edges are tabled
+ *      in the constructor, so an edge is checked in O(1) time
+ *      without searching the adjacency.
+ *      T must hold every value in [0, 2 * (max degree + 2)].
+ *****/
+template<typename T = int>
 class RangeDegreeSpec :
-    public tdzdd::PodArrayDdSpec<RangeDegreeSpec, int, 2> {
+    public tdzdd::PodArrayDdSpec<RangeDegreeSpec<T>, T, 2> {
 private:
+    struct Endpoint {
+        int index; // frontier index
+        int rest;  // number of edges after this item
+        int lb, ub;
+    };
+
     const Graph& G;
     const int F;
-    const std::vector<int>& lb;
-    const std::vector<int>& ub;
     const bool with_vertex;
 
-    const int TAKE_FLAG = 1 << 30;
-    const int COMPLETE = (1 << 20) - 1;
+    const T TAKE_FLAG = T(1) << (std::numeric_limits<T>::digits - 1);
+    const T COMPLETE = TAKE_FLAG - 1;
 
-    std::vector<std::vector<int>> adj;
+    // endpoint[2 * i + j] for the j'th vertex of edge item i
+    std::vector<Endpoint> endpoint;
 
-    void add_degree(int* mate, int i) const {
+    void add_degree(T* mate, int i) const {
         if ((mate[i] & COMPLETE) != COMPLETE) ++mate[i];
         mate[i] |= TAKE_FLAG;
     }
 
-    bool check_conditions(int* mate, int i, int vi, int v) const {
-        int deg = mate[vi] & COMPLETE;
-        if (deg == COMPLETE) return true;
-        if (deg > ub[v]) return false;
-        auto it = std::upper_bound(adj[v].begin(), adj[v].end(), i);
-        int max_deg = deg + (adj[v].end() - it);
-        if (max_deg < lb[v]) return false;
-        if (lb[v] <= deg and max_deg <= ub[v]) mate[vi] |= COMPLETE;
-        return true;
+    // false if the degree can no longer end in [lb, ub];
+    // mark it COMPLETE once every completion ends in [lb, ub]
+    bool check_conditions(T* mate, const Endpoint& e) const {
+        long long deg = mate[e.index] & COMPLETE;
+        bool complete = (deg == (long long)COMPLETE);
+        long long max_deg = deg + e.rest;
+        bool ok = complete | ((deg <= e.ub) & (max_deg >= e.lb));
+        bool decided = (e.lb <= deg) & (max_deg <= e.ub);
+        mate[e.index] |= (COMPLETE & -(T)decided);
+        return ok;
     }
 
 public:
@@ -48,37 +85,37 @@ public:
         const std::vector<int>& lb,
         const std::vector<int>& ub,
         bool with_vertex=false
-    ) : G(G), F(G.max_frontier_size()),
-        lb(lb), ub(ub), with_vertex(with_vertex)
+    ) : G(G), F(G.max_frontier_size()), with_vertex(with_vertex)
     {
         int n = G.max_vertex_number() + 1;
         assert((int)lb.size() == n);
         assert((int)ub.size() == n);
         for (int v = 0; v < n; ++v) assert(lb[v] <= ub[v]);
 
-        adj.assign(n, std::vector<int>());
-        int m = G.n_edges();
-        for (int i = 0; i < m; ++i) {
-            int ei = G.var_of_edge(i);
-            adj[G[ei][0]].push_back(ei);
-            adj[G[ei][1]].push_back(ei);
+        std::vector<int> rest = make_remaining_degree_table(G);
+        endpoint.assign(2 * G.n_items(), Endpoint{0, 0, 0, 0});
+        for (int i = 0; i < G.n_items(); ++i) {
+            if (G.is_vertex(i)) continue;
+            int u = G.item_v0(i), v = G.item_v1(i);
+            endpoint[2 * i] = {G.frontier_index(u), rest[2 * i], lb[u], ub[u]};
+            endpoint[2 * i + 1] = {G.frontier_index(v), rest[2 * i + 1], lb[v], ub[v]};
         }
-        
-        setArraySize(F);
+
+        this->setArraySize(F);
     }
 
-    int getRoot(int* mate) const {
+    int getRoot(T* mate) const {
         for (int i = 0; i < F; ++i) mate[i] = 0;
         return G.n_items();
     }
 
-    int getChild(int* mate, int level, bool take) const {
+    int getChild(T* mate, int level, bool take) const {
         int i = G.n_items() - level;
         
         if (G.is_vertex(i)) {
             if (take and not with_vertex) return 0;
-            // G[i][0] leaves frontier
-            int vi = G.frontier_index(G[i][0]);
+            // the vertex of item i leaves frontier
+            int vi = G.frontier_index(G.item_v0(i));
             if (with_vertex) {
                 if (not take and (mate[vi] & TAKE_FLAG) != 0) return 0;
                 if (take and (mate[vi] & TAKE_FLAG) == 0) return 0;
@@ -86,16 +123,16 @@ public:
             mate[vi] = 0;
         }
         else {
-            int u = G[i][0], v = G[i][1];
-            int ui = G.frontier_index(u), vi = G.frontier_index(v);
+            const Endpoint& eu = endpoint[2 * i];
+            const Endpoint& ev = endpoint[2 * i + 1];
 
             if (take) {
-                add_degree(mate, ui);
-                add_degree(mate, vi);
+                add_degree(mate, eu.index);
+                add_degree(mate, ev.index);
             }
 
-            if (!check_conditions(mate, i, ui, u)) return 0;
-            if (!check_conditions(mate, i, vi, v)) return 0;
+            if (!check_conditions(mate, eu)) return 0;
+            if (!check_conditions(mate, ev)) return 0;
         }
 
         return (level > 1 ? level - 1 : -1);
@@ -103,15 +140,27 @@ public:
 };
 
 /*****
- * class DegreeSpec
+ * class DegreeSpec<T=int>
+ *      After each edge, a degree is pruned unless some candidate lies
+ *      between it and it plus the number of the remaining edges
+ *      (see make_remaining_degree_table).
+ *      T must hold every value in [0, max candidate + 1].
  *****/
-class DegreeSpec : public tdzdd::PodArrayDdSpec<DegreeSpec, int, 2> {
+template<typename T = int>
+class DegreeSpec : public tdzdd::PodArrayDdSpec<DegreeSpec<T>, T, 2> {
 private:
     const Graph& G;
     const int F;
     const std::vector<std::set<int>>& candidates;
     const bool with_vertex;
 
+    std::vector<int> rest;
+
+    bool reachable(int v, int deg, int rest_v) const {
+        auto it = candidates[v].lower_bound(deg);
+        return it != candidates[v].end() and *it <= deg + rest_v;
+    }
+
 public:
     DegreeSpec(
         const Graph& G,
@@ -122,21 +171,22 @@ public:
     {
         int n = G.max_vertex_number() + 1;
         assert((int)candidates.size() == n);
-        setArraySize(F);
+        rest = make_remaining_degree_table(G);
+        this->setArraySize(F);
     }
 
-    int getRoot(int* mate) const {
+    int getRoot(T* mate) const {
         for (int i = 0; i < F; ++i) mate[i] = 0;
         return G.n_items();
     }
 
-    int getChild(int* mate, int level, bool take) const {
+    int getChild(T* mate, int level, bool take) const {
         int i = G.n_items() - level;
 
         if (G.is_vertex(i)) {
             if (take and not with_vertex) return 0;
-            // G[i][0] leaves frontier
-            int v = G[i][0];
+            // the vertex of item i leaves frontier
+            int v = G.item_v0(i);
             int vi = G.frontier_index(v);
             if (with_vertex) {
                 if (not take and mate[vi] > 0) return 0;
@@ -146,13 +196,15 @@ public:
             if (candidates[v].count(mate[vi]) == 0) return 0;
             mate[vi] = 0;
         }
-        else if (take) {
-            int u = G[i][0], v = G[i][1];
+        else {
+            int u = G.item_v0(i), v = G.item_v1(i);
             int ui = G.frontier_index(u), vi = G.frontier_index(v);
-            ++mate[ui];
-            ++mate[vi];
-            if (*candidates[u].rbegin() < mate[ui]) return 0;
-            if (*candidates[v].rbegin() < mate[vi]) return 0;
+            if (take) {
+                ++mate[ui];
+                ++mate[vi];
+            }
+            if (not reachable(u, mate[ui], rest[2 * i])) return 0;
+            if (not reachable(v, mate[vi], rest[2 * i + 1])) return 0;
         }
 
         return (level > 1 ? level - 1 : -1);
@@ -161,49 +213,51 @@ public:
 
 /*****
  * class SteinerSpec
+ *      The state is a flag array over frontier indices;
+ *      the flag of a vertex is set once one of its edges is taken.
  *****/
-class SteinerSpec : public tdzdd::PodArrayDdSpec<SteinerSpec, int, 2> {
+class SteinerSpec : public tdzdd::PodArrayDdSpec<SteinerSpec, uint64_t, 2> {
 private:
     const Graph& G;
     const int F;
-    const std::set<int>& T;
+    const int W;
+    const std::set<int>& terminals;
     const bool with_vertex;
 
 public:
     SteinerSpec(
         const Graph& G,
-        const std::set<int>& T,
+        const std::set<int>& terminals,
         bool with_vertex = false
-    ) : G(G), F(G.max_frontier_size()), T(T), with_vertex(with_vertex)
+    ) : G(G), F(G.max_frontier_size()), W(flag_words(F)),
+        terminals(terminals), with_vertex(with_vertex)
     {
-        setArraySize(F);
+        setArraySize(W);
     }
 
-    int getRoot(int* mate) const {
-        for (int i = 0; i < F; ++i) mate[i] = 0;
+    int getRoot(uint64_t* touched) const {
+        for (int w = 0; w < W; ++w) touched[w] = 0;
         return G.n_items();
     }
 
-    int getChild(int* mate, int level, bool take) const {
+    int getChild(uint64_t* touched, int level, bool take) const {
         int i = G.n_items() - level;
 
         if (G.is_vertex(i)) {
             if (take and not with_vertex) return 0;
-            // G[i][0] leaves frontier
-            int v = G[i][0];
+            // the vertex of item i leaves frontier
+            int v = G.item_v0(i);
             int vi = G.frontier_index(v);
-            if (with_vertex) {
-                if (not take and mate[vi] > 0) return 0;
-                if (take and mate[vi] == 0) return 0;
-            }
+            bool t = test_flag(touched, vi);
+            if (with_vertex and take != t) return 0;
             // check terminal
-            if (mate[vi] == 0 and T.count(v) == 1) return 0;
-            mate[vi] = 0;
+            if (not t and terminals.count(v) == 1) return 0;
+            reset_flag(touched, vi);
         }
         else if (take) {
-            int u = G[i][0], v = G[i][1];
-            int ui = G.frontier_index(u), vi = G.frontier_index(v);
-            mate[ui] = mate[vi] = 1;
+            int u = G.item_v0(i), v = G.item_v1(i);
+            set_flag(touched, G.frontier_index(u));
+            set_flag(touched, G.frontier_index(v));
         }
 
         return (level > 1 ? level - 1 : -1);
@@ -0,0 +1,40 @@
+#ifndef SAPPORO_TDZDD_APPS_FLAG_ARRAY_HPP
+#define SAPPORO_TDZDD_APPS_FLAG_ARRAY_HPP
+
+#include <cstdint>
+
+namespace sapporo_tdzdd_apps {
+
+/*****
+ * Flag arrays
+ *      Bitset states for binary-flag constraints, packed into 64-bit words
+ *      so that tdzdd::PodArrayDdSpec<S, uint64_t, 2> hashes and compares
+ *      64 flags per word operation.
+ * 
+ * int flag_words(int n_flags)
+ *      Get the number of words to hold n_flags flags.
+ * 
+ * bool test_flag(const uint64_t* flags, int i)
+ * void set_flag(uint64_t* flags, int i)
+ * void reset_flag(uint64_t* flags, int i)
+ *      Test, set and reset the i'th flag.
+ *****/
+int flag_words(int n_flags) {
+    return (n_flags + 63) / 64;
+}
+
+bool test_flag(const uint64_t* flags, int i) {
+    return (flags[i >> 6] >> (i & 63)) & 1;
+}
+
+void set_flag(uint64_t* flags, int i) {
+    flags[i >> 6] |= uint64_t(1) << (i & 63);
+}
+
+void reset_flag(uint64_t* flags, int i) {
+    flags[i >> 6] &= ~(uint64_t(1) << (i & 63));
+}
+
+} // namespace sapporo_tdzdd_apps
+
+#endif
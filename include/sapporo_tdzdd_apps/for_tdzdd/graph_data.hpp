@@ -2,11 +2,16 @@
 #define SAPPORO_TDZDD_APPS_GRAPH_DATA_HPP
 
 #include <istream>
+#include <ostream>
 #include <vector>
 #include <set>
-#include <map>
+#include <unordered_map>
 #include <queue>
 #include <algorithm>
+#include <utility>
+#include <tuple>
+#include <limits>
+#include <cstdint>
 #include <cassert>
 
 namespace sapporo_tdzdd_apps {
@@ -14,6 +19,8 @@ namespace sapporo_tdzdd_apps {
 /*****
  * class Graph
  *      Maintain a graph data (allowing multiple edges).
+ *      Edges and items are kept as flat arrays (one array per field),
+ *      so the specs read the item of a level from contiguous memory.
  *      Assuming that vertex number is non negative,
  *      and it does not have to be 0-indexed and continuous.
  *      The graph can be treated as a directed graph such that
@@ -28,7 +35,13 @@ namespace sapporo_tdzdd_apps {
  * 
  * void add_edge(int v0, int v1)
  *      Add an edge v0-v1.
- *      Note that this method takes O(log |V|) time.
+ *      Note that this method takes amortized O(1) time.
+ * 
+ * void add_edges(const std::vector<int>& v0, const std::vector<int>& v1)
+ *      Add edges v0[k]-v1[k] for all k at once.
+ * 
+ * std::pair<int, int> edge(int i) const
+ *      Get the edge i as (v0, v1).
  * 
  * int max_vertex_number() const
  *      Get the maximum vertex number.
@@ -38,10 +51,36 @@ namespace sapporo_tdzdd_apps {
  * 
  * int n_edges() const
  *      Get the number of edges.
+ * 
+ * std::vector<int> vertices() const
+ *      Get the vertex numbers in ascending order.
+ *      Note that this method takes O(max_vertex_number()) time.
  *  
  * void setup()
  *      Setup for subgraph enumeration.
- *      Note that this method takes O(|E| log |V|) time.
+ *      Edges are processed in the order of addition.
+ *      Note that this method takes O(|V| + |E| log F) expected time,
+ *      where F is the maximum frontier size.
+ * 
+ * void setup(const std::vector<int>& order)
+ *      Setup for subgraph enumeration.
+ *      Edges are processed in the given order,
+ *      which must be a permutation of edge numbers {0, 1, ..., |E| - 1}.
+ *      Edge numbers themselves (e.g., for var_of_edge) are not changed.
+ * 
+ * const std::vector<int>& edge_order() const
+ *      Get the edge order used in the last setup.
+ *      This function works after calling setup().
+ * 
+ * std::pair<std::vector<int>, int> beam_search_edge_order(int beam_width=16)
+ *      Find an edge order with a small maximum frontier size by beam search.
+ *      Each step appends an edge adjacent to the current frontier
+ *      (or, if it is empty, an edge of a remaining vertex of minimum degree)
+ *      and keeps the beam_width best partial orders ranked by
+ *      (maximum frontier size so far, current frontier size).
+ *      Return the order and its maximum frontier size,
+ *      which is max_frontier_size() after setup(order).
+ *      Note that this method takes O(beam_width |E| (|V| + |E|)) time.
  * 
  * int n_items() const
  *      Get the number of items (vertices and edges).
@@ -61,11 +100,14 @@ namespace sapporo_tdzdd_apps {
  *      For subgraph enumeration.
  *      This function works after calling setup().
  * 
- * const std::vector<int>& operator [](int i)
- *      Get i'th item.
- *      Vertex item is a singleton {vertex number}.
- *      Edge item is a vector of length 3
- *      {1st vertex, 2nd vertex, multiplicity on items {0, 1, ..., i}}.
+ * int item_v0(int i) const / int item_v1(int i) const
+ *      Get the 1st and 2nd vertices of the i'th item if it is an edge.
+ *      For a vertex item, item_v0 is the vertex and item_v1 is -1.
+ *      This function works after calling setup().
+ * 
+ * int item_multiplicity(int i) const
+ *      Get the multiplicity of the i'th item (an edge) on items
+ *      {0, 1, ..., i}, or 0 for a vertex item.
  *      This function works after calling setup().
  * 
  * int var_of_vertex(int v) const
@@ -79,106 +121,354 @@ namespace sapporo_tdzdd_apps {
  * 
  * int sapporo_var_of_edge(int i) const
  *      Return the variable number of an edge i for SAPPOROBDD.
+ * 
+ * void write_binary(std::ostream& os) const
+ *      Write the graph and its setup (item layout) in binary.
+ * 
+ * bool read_binary(std::istream& is)
+ *      Restore a graph written by write_binary, including its setup.
+ *      Return false if the input is broken, i.e. truncated or with an
+ *      index out of range of the arrays it refers to.
  *****/
 class Graph {
 private:
-    std::set<int> vertex;
-    std::vector<std::vector<int>> edge;
+    std::vector<uint8_t> has_vertex;
+    int n_vertex;
+    std::vector<int> edge_v0, edge_v1;
 
-    std::vector<std::vector<int>> item;
+    std::vector<int> order;
+    // items: item_v1 = -1 marks a vertex item; orig is the original
+    // vertex or edge number
+    std::vector<int> it_v0, it_v1, it_mult, it_orig;
     std::vector<int> v_to_item;
     std::vector<int> e_to_item;
     std::vector<int> f_index;
     int max_f_size;
 
+    static void write_ints(std::ostream& os, const std::vector<int>& v) {
+        uint64_t size = v.size();
+        os.write((const char*)&size, sizeof(size));
+        os.write((const char*)v.data(), sizeof(int) * size);
+    }
+
+    static bool read_ints(std::istream& is, std::vector<int>& v) {
+        uint64_t size = 0;
+        if (not is.read((char*)&size, sizeof(size))) return false;
+        if (size > (uint64_t)std::numeric_limits<int>::max()) return false;
+        // grow chunk by chunk, so that a broken size runs into the end
+        // of the input instead of allocating all at once
+        const uint64_t chunk = 1 << 16;
+        v.clear();
+        for (uint64_t done = 0; done < size; done += chunk) {
+            uint64_t k = std::min(chunk, size - done);
+            v.resize(done + k);
+            if (not is.read((char*)(v.data() + done), sizeof(int) * k)) return false;
+        }
+        return true;
+    }
+
+    // whether the arrays read by read_binary form a graph with its setup
+    bool is_consistent() const {
+        int n = max_vertex_number() + 1, m = n_edges(), k = it_v0.size();
+        if ((int)v_to_item.size() != n or (int)f_index.size() != n) return false;
+        if ((int)e_to_item.size() != m or (int)order.size() != m) return false;
+        auto in = [](int x, int lo, int hi) { return lo <= x and x < hi; };
+        auto is_endpoint = [&](int v) {
+            return in(v, 0, n) and has_vertex[v] and f_index[v] >= 0;
+        };
+
+        int max_f = 0;
+        for (int v = 0; v < n; ++v) {
+            if (not in(f_index[v], -1, n)) return false;
+            if (not in(v_to_item[v], -1, k)) return false;
+            max_f = std::max(max_f, f_index[v] + 1);
+        }
+        if (max_f_size != max_f) return false;
+        for (int i = 0; i < m; ++i) {
+            if (not is_endpoint(edge_v0[i]) or not is_endpoint(edge_v1[i])) return false;
+            if (edge_v0[i] == edge_v1[i]) return false;
+            if (not in(order[i], 0, m) or not in(e_to_item[i], 0, k)) return false;
+        }
+        for (int i = 0; i < k; ++i) {
+            if (not is_endpoint(it_v0[i]) or it_mult[i] < 0) return false;
+            if (it_v1[i] == -1) {
+                if (not in(it_orig[i], 0, n)) return false;
+            }
+            else if (not is_endpoint(it_v1[i]) or not in(it_orig[i], 0, m)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void add_vertex(int v) {
+        if (v >= (int)has_vertex.size()) has_vertex.resize(v + 1, 0);
+        if (has_vertex[v] == 0) {
+            has_vertex[v] = 1;
+            ++n_vertex;
+        }
+    }
+
+    void push_item(int v0, int v1, int mult, int orig) {
+        it_v0.push_back(v0);
+        it_v1.push_back(v1);
+        it_mult.push_back(mult);
+        it_orig.push_back(orig);
+    }
+
 public:
-    Graph() : max_f_size(0) {}
+    Graph() : n_vertex(0), max_f_size(0) {}
 
     /***** for original graph *****/
     void add_edge(int v0, int v1) {
         assert(v0 >= 0 and v1 >=0 and v0 != v1);
-        if (vertex.count(v0) == 0) vertex.insert(v0);
-        if (vertex.count(v1) == 0) vertex.insert(v1);
-        edge.push_back({v0, v1});
+        add_vertex(v0);
+        add_vertex(v1);
+        edge_v0.push_back(v0);
+        edge_v1.push_back(v1);
         max_f_size = 0;
     }
 
+    void add_edges(const std::vector<int>& v0, const std::vector<int>& v1) {
+        assert(v0.size() == v1.size());
+        int max_v = max_vertex_number();
+        for (size_t k = 0; k < v0.size(); ++k) {
+            assert(v0[k] >= 0 and v1[k] >= 0 and v0[k] != v1[k]);
+            max_v = std::max(max_v, std::max(v0[k], v1[k]));
+        }
+        has_vertex.resize(max_v + 1, 0);
+        for (size_t k = 0; k < v0.size(); ++k) {
+            add_vertex(v0[k]);
+            add_vertex(v1[k]);
+        }
+        edge_v0.insert(edge_v0.end(), v0.begin(), v0.end());
+        edge_v1.insert(edge_v1.end(), v1.begin(), v1.end());
+        max_f_size = 0;
+    }
+
+    std::pair<int, int> edge(int i) const {
+        assert(0 <= i and i < n_edges());
+        return std::make_pair(edge_v0[i], edge_v1[i]);
+    }
+
     int max_vertex_number() const {
-        return *vertex.rbegin();
+        return (int)has_vertex.size() - 1;
     }
 
     int n_vertices() const {
-        return vertex.size();
+        return n_vertex;
     }
 
     int n_edges() const {
-        return edge.size();
+        return edge_v0.size();
     }
 
-    const std::set<int>& vertices() const {
-        return vertex;
+    std::vector<int> vertices() const {
+        std::vector<int> vs;
+        vs.reserve(n_vertex);
+        for (int v = 0; v < (int)has_vertex.size(); ++v) {
+            if (has_vertex[v]) vs.push_back(v);
+        }
+        return vs;
     }
 
     /***** for subgraph enumeration *****/
     void setup() {
+        std::vector<int> identity(n_edges());
+        for (int i = 0; i < n_edges(); ++i) identity[i] = i;
+        setup(identity);
+    }
+
+    void setup(const std::vector<int>& edge_order) {
         int n = max_vertex_number() + 1, m = n_edges();
+        assert((int)edge_order.size() == m);
 
-        item.clear();
+        order = edge_order;
+        for (std::vector<int>* a : {&it_v0, &it_v1, &it_mult, &it_orig}) {
+            a->clear();
+            a->reserve(n_vertex + m);
+        }
         v_to_item.assign(n, -1);
         e_to_item.assign(m, -1);
         f_index.assign(n, -1);
         max_f_size = 0;
 
         std::vector<int> edge_count(n, 0);
-        std::map<std::vector<int>, int> multiplicity;
         for (int i = 0; i < m; ++i) {
-            ++edge_count[edge[i][0]];
-            ++edge_count[edge[i][1]];
-            multiplicity[edge[i]] = 0;
+            ++edge_count[edge_v0[i]];
+            ++edge_count[edge_v1[i]];
         }
+        // multiplicity of each ordered pair so far
+        std::unordered_map<uint64_t, int> multiplicity;
+        multiplicity.reserve(m);
 
-        std::vector<bool> visited(n, false);
+        // freed frontier indices; indices from next_index on are unused
         std::priority_queue<int, std::vector<int>, std::greater<int>> que;
-        for (int i = 0; i < n; ++i) que.push(i);
-
-        for (int i = 0; i < m; ++i){
-            --edge_count[edge[i][0]];
-            --edge_count[edge[i][1]];
-            ++multiplicity[edge[i]];
-            
-            e_to_item[i] = item.size();
-            item.push_back({edge[i][0], edge[i][1], multiplicity[edge[i]], i});
-
-            for (int j = 0; j < 2; ++j) {
-                int v = edge[i][j];
-                if (not visited[v]) {
-                    visited[v] = true;
-                    int idx = que.top(); que.pop();
+        int next_index = 0;
+
+        for (int k = 0; k < m; ++k){
+            int i = order[k];
+            assert(0 <= i and i < m and e_to_item[i] == -1);
+            int v0 = edge_v0[i], v1 = edge_v1[i];
+            --edge_count[v0];
+            --edge_count[v1];
+            int mult = ++multiplicity[(uint64_t)v0 << 32 | (uint32_t)v1];
+
+            e_to_item[i] = it_v0.size();
+            push_item(v0, v1, mult, i);
+
+            for (int v : {v0, v1}) {
+                if (f_index[v] == -1) {
+                    int idx = next_index;
+                    if (que.empty()) ++next_index;
+                    else {
+                        idx = que.top();
+                        que.pop();
+                    }
                     f_index[v] = idx;
                     max_f_size = std::max(max_f_size, idx + 1);
                 }
             }
 
-            for (int j = 0; j < 2; ++j) {
-                int v = edge[i][j];
+            for (int v : {v0, v1}) {
                 if (edge_count[v] == 0) {
-                    v_to_item[v] = item.size();
-                    item.push_back({v});
+                    v_to_item[v] = it_v0.size();
+                    push_item(v, -1, 0, v);
                     que.push(f_index[v]);
                 }
             }
         }
     }
 
+    const std::vector<int>& edge_order() const {
+        assert(max_f_size > 0);
+        return order;
+    }
+
+    std::pair<std::vector<int>, int> beam_search_edge_order(
+        int beam_width = 16
+    ) const {
+        assert(beam_width > 0);
+        int n = max_vertex_number() + 1, m = n_edges();
+
+        std::vector<std::vector<int>> incident(n);
+        for (int i = 0; i < m; ++i) {
+            incident[edge_v0[i]].push_back(i);
+            incident[edge_v1[i]].push_back(i);
+        }
+
+        // a partial order; states with the same set of used edges
+        // have the same future, so they are identified by key
+        struct State {
+            std::vector<int> order;
+            std::vector<bool> used;
+            std::vector<int> rest; // number of unused edges of each vertex
+            std::vector<int> frontier;
+            int f_size, max_f;
+            uint64_t key;
+        };
+        struct Candidate {
+            int max_f, f_size, parent, e;
+            bool operator <(const Candidate& c) const {
+                return std::tie(max_f, f_size, parent, e) <
+                       std::tie(c.max_f, c.f_size, c.parent, c.e);
+            }
+        };
+        auto edge_key = [](int e) {
+            uint64_t x = (uint64_t)e + 0x9e3779b97f4a7c15ULL;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+            return x ^ (x >> 31);
+        };
+
+        State init;
+        init.used.assign(m, false);
+        init.rest.assign(n, 0);
+        for (int v = 0; v < n; ++v) init.rest[v] = incident[v].size();
+        init.f_size = init.max_f = 0;
+        init.key = 0;
+        std::vector<State> beam(1, init);
+
+        for (int step = 0; step < m; ++step) {
+            std::vector<Candidate> cand;
+            for (int p = 0; p < (int)beam.size(); ++p) {
+                const State& st = beam[p];
+                auto add_candidate = [&](int e) {
+                    int u = edge_v0[e], v = edge_v1[e];
+                    int enter = 0, leave = 0;
+                    for (int w : {u, v}) {
+                        if (st.rest[w] == (int)incident[w].size()) ++enter;
+                        if (st.rest[w] == 1) ++leave;
+                    }
+                    int size = st.f_size + enter;
+                    cand.push_back({std::max(st.max_f, size), size - leave, p, e});
+                };
+                if (not st.frontier.empty()) {
+                    for (int v : st.frontier) {
+                        for (int e : incident[v]) {
+                            // each edge is proposed once per state
+                            int w = edge_v0[e] == v ? edge_v1[e] : edge_v0[e];
+                            bool w_in_frontier =
+                                st.rest[w] > 0 and
+                                st.rest[w] < (int)incident[w].size();
+                            if (w_in_frontier and w < v) continue;
+                            if (not st.used[e]) add_candidate(e);
+                        }
+                    }
+                }
+                else {
+                    int seed = -1;
+                    for (int v = 0; v < n; ++v) {
+                        if (st.rest[v] == 0) continue;
+                        if (seed == -1 or st.rest[v] < st.rest[seed]) seed = v;
+                    }
+                    for (int e : incident[seed]) add_candidate(e);
+                }
+            }
+
+            std::sort(cand.begin(), cand.end());
+            std::vector<State> next;
+            std::set<uint64_t> seen;
+            for (const Candidate& c : cand) {
+                if ((int)next.size() == beam_width) break;
+                const State& st = beam[c.parent];
+                uint64_t key = st.key ^ edge_key(c.e);
+                if (seen.count(key) == 1) continue;
+                seen.insert(key);
+
+                State ns = st;
+                ns.order.push_back(c.e);
+                ns.used[c.e] = true;
+                for (int w : {edge_v0[c.e], edge_v1[c.e]}) {
+                    if (ns.rest[w] == (int)incident[w].size()) {
+                        ns.frontier.push_back(w);
+                    }
+                    --ns.rest[w];
+                }
+                ns.frontier.erase(
+                    std::remove_if(ns.frontier.begin(), ns.frontier.end(),
+                                   [&](int w) { return ns.rest[w] == 0; }),
+                    ns.frontier.end());
+                ns.f_size = c.f_size;
+                ns.max_f = c.max_f;
+                ns.key = key;
+                next.push_back(ns);
+            }
+            beam.swap(next);
+        }
+
+        return std::make_pair(beam[0].order, beam[0].max_f);
+    }
+
     int n_items() const {
         assert(max_f_size > 0);
-        return item.size();
+        return it_v0.size();
     }
 
     bool is_vertex(int i) const {
         assert(max_f_size > 0);
         assert(0 <= i and i < n_items());
-        return item[i].size() == 1;
+        return it_v1[i] < 0;
     }
 
     int max_frontier_size() const {
@@ -193,23 +483,35 @@ public:
         return f_index[v];
     }
 
-    const std::vector<int>& operator [](int i) const {
+    int item_v0(int i) const {
+        assert(max_f_size > 0);
+        assert(0 <= i and i < n_items());
+        return it_v0[i];
+    }
+
+    int item_v1(int i) const {
+        assert(max_f_size > 0);
+        assert(0 <= i and i < n_items());
+        return it_v1[i];
+    }
+
+    int item_multiplicity(int i) const {
         assert(max_f_size > 0);
         assert(0 <= i and i < n_items());
-        return item[i];
+        return it_mult[i];
     }
 
     /***** for after subgraph enumeration *****/
     int vertex_of_var(int i) const {
         assert(max_f_size > 0);
-        assert(item[i].size() == 1);
-        return item[i].back();
+        assert(is_vertex(i));
+        return it_orig[i];
     }
 
     int edge_of_var(int i) const {
         assert(max_f_size > 0);
-        assert(item[i].size() == 4);
-        return item[i].back();
+        assert(not is_vertex(i));
+        return it_orig[i];
     }
 
     int var_of_vertex(int v) const {
@@ -235,6 +537,47 @@ public:
         assert(0 <= i and i < n_edges());
         return n_items() - e_to_item[i];
     }
+
+    /***** binary input/output *****/
+    void write_binary(std::ostream& os) const {
+        write_ints(os, vertices());
+        write_ints(os, edge_v0);
+        write_ints(os, edge_v1);
+        write_ints(os, order);
+        write_ints(os, it_v0);
+        write_ints(os, it_v1);
+        write_ints(os, it_mult);
+        write_ints(os, it_orig);
+        write_ints(os, v_to_item);
+        write_ints(os, e_to_item);
+        write_ints(os, f_index);
+        write_ints(os, std::vector<int>{max_f_size});
+    }
+
+    bool read_binary(std::istream& is) {
+        std::vector<int> vs, mf;
+        bool ok = read_ints(is, vs) and read_ints(is, edge_v0)
+                  and read_ints(is, edge_v1) and read_ints(is, order)
+                  and read_ints(is, it_v0) and read_ints(is, it_v1)
+                  and read_ints(is, it_mult) and read_ints(is, it_orig)
+                  and read_ints(is, v_to_item) and read_ints(is, e_to_item)
+                  and read_ints(is, f_index) and read_ints(is, mf)
+                  and mf.size() == 1 and edge_v0.size() == edge_v1.size()
+                  and it_v1.size() == it_v0.size()
+                  and it_mult.size() == it_v0.size()
+                  and it_orig.size() == it_v0.size();
+        if (not ok) return false;
+        has_vertex.clear();
+        n_vertex = 0;
+        // v_to_item has one entry per vertex number, so it bounds vs
+        // before has_vertex is sized by them
+        for (int v : vs) {
+            if (v < 0 or v >= (int)v_to_item.size()) return false;
+        }
+        for (int v : vs) add_vertex(v);
+        max_f_size = mf[0];
+        return is_consistent();
+    }
 }; // class Graph
 
 } // namespace sapporo_tdzdd_apps
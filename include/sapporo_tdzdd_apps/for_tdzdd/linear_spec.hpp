@@ -4,36 +4,109 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <limits>
+#include <queue>
+#include <tuple>
+#include <utility>
+#include <functional>
+#include <cassert>
 #include <tdzdd/DdSpec.hpp>
 
 namespace sapporo_tdzdd_apps {
 
+/*****
+ * struct CsrMatrix
+ *      Sparse matrix in compressed sparse row form. The nonzeros of row r
+ *      are (col_index[k], value[k]) for row_ptr[r] <= k < row_ptr[r+1].
+ *      Columns of a row may come in any order; entries repeating a
+ *      column are added up.
+ *****/
+struct CsrMatrix {
+    int n_rows = 0;
+    int n_cols = 0;
+    std::vector<int> row_ptr;
+    std::vector<int> col_index;
+    std::vector<int> value;
+};
+
+/*****
+ * make_csr_matrix(A)
+ *      Convert a dense matrix into CsrMatrix, dropping zero entries.
+ *****/
+CsrMatrix make_csr_matrix(const std::vector<std::vector<int>>& A) {
+    CsrMatrix M;
+    M.n_rows = A.size();
+    M.n_cols = (A.empty() ? 0 : A[0].size());
+    M.row_ptr.push_back(0);
+    for (int r = 0; r < M.n_rows; ++r) {
+        for (int i = 0; i < M.n_cols; ++i) {
+            if (A[r][i] == 0) continue;
+            M.col_index.push_back(i);
+            M.value.push_back(A[r][i]);
+        }
+        M.row_ptr.push_back(M.col_index.size());
+    }
+    return M;
+}
+
+// clamp a bound into int, keeping INT_MIN free for the SAT marker
+int clamp_sum(long long x) {
+    x = std::max(x, (long long)std::numeric_limits<int>::min() + 1);
+    x = std::min(x, (long long)std::numeric_limits<int>::max());
+    return x;
+}
+
 /*****
  * class LinearIneqSpec
+ *      mate[r] is the partial sum of row r over the decided items,
+ *      or SAT once every completion satisfies row r.
+ *      Each sign is turned into bounds lo[r] <= (Ax)_r <= hi[r], and from
+ *      the remaining negative/positive sums the constructor derives,
+ *      for every item i, the interval of partial sums that can still be
+ *      completed (keep_min/keep_max) and the interval that is already
+ *      decided (sat_min/sat_max). Collapsing decided rows to SAT lets
+ *      the builder merge nodes that differ only in irrelevant sums.
+ *      A and the thresholds are stored column-major (index i * n_rows + r),
+ *      and row updates and checks are branch-free loops over r,
+ *      which compilers vectorize at -O3.
  *****/
 class LinearIneqSpec : public tdzdd::PodArrayDdSpec<LinearIneqSpec, int, 2> {
 private:
     const int n_vars;
     const int n_rows;
-    const std::vector<std::vector<int>>& A;
-    const std::vector<std::string>& sign;
-    const std::vector<int>& b;
 
-    std::vector<std::vector<int>> neg_sum;
-    std::vector<std::vector<int>> pos_sum;
+    const int SAT = std::numeric_limits<int>::min();
+
+    std::vector<int> col;
+    std::vector<int> keep_min;
+    std::vector<int> keep_max;
+    std::vector<int> sat_min;
+    std::vector<int> sat_max;
 
     void add_item(int* mate, int i) const {
-        for (int r = 0; r < n_rows; ++r) mate[r] += A[r][i];
+        const int* a = col.data() + (size_t)i * n_rows;
+        for (int r = 0; r < n_rows; ++r) {
+            mate[r] = (mate[r] == SAT ? SAT : mate[r] + a[r]);
+        }
     }
 
-    bool check_conditions(int* mate, int i) const {
+    // check rows before deciding item i, and collapse decided rows
+    bool update_conditions(int* mate, int i) const {
+        size_t k = (size_t)i * n_rows;
+        const int* kmin = keep_min.data() + k;
+        const int* kmax = keep_max.data() + k;
+        const int* smin = sat_min.data() + k;
+        const int* smax = sat_max.data() + k;
+        int ok = 1;
         for (int r = 0; r < n_rows; ++r) {
-            int lb = mate[r] + neg_sum[r][i];
-            int ub = mate[r] + pos_sum[r][i];
-            if ((sign[r] == "<=" or sign[r] == "=") and lb > b[r]) return false;
-            if ((sign[r] == ">=" or sign[r] == "=") and ub < b[r]) return false;
+            int m = mate[r];
+            int sat = (m == SAT);
+            int keep = (m >= kmin[r]) & (m <= kmax[r]);
+            int done = (m >= smin[r]) & (m <= smax[r]);
+            ok &= sat | keep;
+            mate[r] = (sat | done ? SAT : m);
         }
-        return true;
+        return ok;
     }
 
 public:
@@ -41,28 +114,192 @@ public:
         const std::vector<std::vector<int>>& A,
         const std::vector<std::string>& sign,
         const std::vector<int>& b
-    ) : n_vars(A[0].size()), n_rows(A.size()), A(A), sign(sign), b(b) {
+    ) : n_vars(A[0].size()), n_rows(A.size()) {
         setArraySize(n_rows);
-        neg_sum.assign(n_rows, std::vector<int>(n_vars + 1, 0));
-        pos_sum.assign(n_rows, std::vector<int>(n_vars + 1, 0));
+
+        const int INF = std::numeric_limits<int>::max();
+        col.assign((size_t)n_vars * n_rows, 0);
+        keep_min.assign((size_t)(n_vars + 1) * n_rows, -INF);
+        keep_max.assign((size_t)(n_vars + 1) * n_rows, INF);
+        sat_min.assign((size_t)(n_vars + 1) * n_rows, -INF);
+        sat_max.assign((size_t)(n_vars + 1) * n_rows, INF);
+
         for (int r = 0; r < n_rows; ++r) {
-            for (int i = n_vars - 1; i >= 0; --i) {
-                neg_sum[r][i] = neg_sum[r][i + 1] + std::min(A[r][i], 0);
-                pos_sum[r][i] = pos_sum[r][i + 1] + std::max(A[r][i], 0);
+            assert(sign[r] == "<=" or sign[r] == ">=" or sign[r] == "=");
+            bool has_lo = (sign[r] == ">=" or sign[r] == "=");
+            bool has_hi = (sign[r] == "<=" or sign[r] == "=");
+            long long neg = 0, pos = 0;
+            for (int i = n_vars; i >= 0; --i) {
+                size_t k = (size_t)i * n_rows + r;
+                if (i < n_vars) {
+                    col[k] = A[r][i];
+                    neg += std::min(A[r][i], 0);
+                    pos += std::max(A[r][i], 0);
+                }
+                if (has_lo) keep_min[k] = clamp_sum(b[r] - pos);
+                if (has_hi) keep_max[k] = clamp_sum(b[r] - neg);
+                if (has_lo) sat_min[k] = clamp_sum(b[r] - neg);
+                if (has_hi) sat_max[k] = clamp_sum(b[r] - pos);
             }
         }
     }
 
     int getRoot(int* mate) const {
         for (int r = 0; r < n_rows; ++r) mate[r] = 0;
-        if (!check_conditions(mate, 0)) return 0;
+        if (!update_conditions(mate, 0)) return 0;
         return n_vars;
     }
 
     int getChild(int* mate, int level, bool take) const {
         int i = n_vars - level;
         if (take) add_item(mate, i);
-        if (!check_conditions(mate, i + 1)) return 0;
+        if (!update_conditions(mate, i + 1)) return 0;
+        return (level > 1 ? level - 1 : -1);
+    }
+};
+
+/*****
+ * class SparseLinearIneqSpec
+ *      LinearIneqSpec for a sparse A given as CsrMatrix.
+ *      A row is active from its first to its last nonzero column,
+ *      and active rows share the slots of mate, so the state size is
+ *      the maximum number of rows active at once. Rows that hold
+ *      for every assignment are dropped in the constructor.
+ *      The entries of column i (slot, coefficient and the same
+ *      keep/SAT thresholds as LinearIneqSpec, computed over the rest
+ *      of the row's support) are stored contiguously, so getChild
+ *      touches only the rows that contain item i.
+ *****/
+class SparseLinearIneqSpec :
+    public tdzdd::PodArrayDdSpec<SparseLinearIneqSpec, int, 2> {
+private:
+    struct Entry {
+        int slot;
+        int a;
+        int keep_min;
+        int keep_max;
+        int sat_min;
+        int sat_max;
+    };
+
+    const int n_vars;
+    int n_slots;
+    bool infeasible;
+
+    const int SAT = std::numeric_limits<int>::min();
+
+    std::vector<int> entry_ptr;
+    std::vector<Entry> entry;
+    std::vector<int> leave_ptr;
+    std::vector<int> leave_slot;
+
+public:
+    SparseLinearIneqSpec(
+        const CsrMatrix& A,
+        const std::vector<std::string>& sign,
+        const std::vector<int>& b
+    ) : n_vars(A.n_cols), n_slots(0), infeasible(false) {
+        const int INF = std::numeric_limits<int>::max();
+        std::vector<std::vector<Entry>> entries(n_vars);
+        std::vector<std::vector<int>> leaves(n_vars);
+
+        // active rows as (first column, last column, row)
+        std::vector<std::tuple<int, int, int>> active;
+        std::vector<std::vector<std::pair<int, int>>> terms(A.n_rows);
+        for (int r = 0; r < A.n_rows; ++r) {
+            assert(sign[r] == "<=" or sign[r] == ">=" or sign[r] == "=");
+            std::vector<std::pair<int, long long>> row;
+            for (int k = A.row_ptr[r]; k < A.row_ptr[r + 1]; ++k) {
+                assert(0 <= A.col_index[k] and A.col_index[k] < n_vars);
+                row.emplace_back(A.col_index[k], A.value[k]);
+            }
+            std::sort(row.begin(), row.end());
+            // entries repeating a column are one variable: sum them up
+            long long neg = 0, pos = 0;
+            for (size_t k = 0; k < row.size(); ) {
+                int i = row[k].first;
+                long long a = 0;
+                for (; k < row.size() and row[k].first == i; ++k) a += row[k].second;
+                if (a == 0) continue;
+                assert(a == (int)a);
+                terms[r].emplace_back(i, (int)a);
+                neg += std::min(a, 0LL);
+                pos += std::max(a, 0LL);
+            }
+            long long lo = (sign[r] == "<=" ? -INF : b[r]);
+            long long hi = (sign[r] == ">=" ? INF : b[r]);
+            if (hi < neg or pos < lo) { infeasible = true; continue; }
+            if (lo <= neg and pos <= hi) continue;
+            active.emplace_back(terms[r].front().first, terms[r].back().first, r);
+        }
+
+        // assign slots greedily in order of first column
+        std::sort(active.begin(), active.end());
+        std::priority_queue<
+            std::pair<int, int>,
+            std::vector<std::pair<int, int>>,
+            std::greater<std::pair<int, int>>
+        > busy; // (last column, slot)
+        std::vector<int> free_slot;
+        for (const auto& t : active) {
+            int first = std::get<0>(t), last = std::get<1>(t), r = std::get<2>(t);
+            while (!busy.empty() and busy.top().first < first) {
+                free_slot.push_back(busy.top().second);
+                busy.pop();
+            }
+            int slot = n_slots;
+            if (free_slot.empty()) ++n_slots;
+            else { slot = free_slot.back(); free_slot.pop_back(); }
+            busy.emplace(last, slot);
+            leaves[last].push_back(slot);
+
+            bool has_lo = (sign[r] == ">=" or sign[r] == "=");
+            bool has_hi = (sign[r] == "<=" or sign[r] == "=");
+            long long neg = 0, pos = 0;
+            for (int k = terms[r].size() - 1; k >= 0; --k) {
+                Entry e = {slot, terms[r][k].second, -INF, INF, -INF, INF};
+                if (has_lo) e.keep_min = clamp_sum(b[r] - pos);
+                if (has_hi) e.keep_max = clamp_sum(b[r] - neg);
+                if (has_lo) e.sat_min = clamp_sum(b[r] - neg);
+                if (has_hi) e.sat_max = clamp_sum(b[r] - pos);
+                entries[terms[r][k].first].push_back(e);
+                neg += std::min(e.a, 0);
+                pos += std::max(e.a, 0);
+            }
+        }
+
+        entry_ptr.push_back(0);
+        leave_ptr.push_back(0);
+        for (int i = 0; i < n_vars; ++i) {
+            entry.insert(entry.end(), entries[i].begin(), entries[i].end());
+            leave_slot.insert(leave_slot.end(), leaves[i].begin(), leaves[i].end());
+            entry_ptr.push_back(entry.size());
+            leave_ptr.push_back(leave_slot.size());
+        }
+
+        setArraySize(std::max(n_slots, 1));
+    }
+
+    int getRoot(int* mate) const {
+        if (infeasible) return 0;
+        for (int j = 0; j < std::max(n_slots, 1); ++j) mate[j] = 0;
+        return n_vars;
+    }
+
+    int getChild(int* mate, int level, bool take) const {
+        int i = n_vars - level;
+        for (int k = entry_ptr[i]; k < entry_ptr[i + 1]; ++k) {
+            const Entry& e = entry[k];
+            int& m = mate[e.slot];
+            if (m == SAT) continue;
+            if (take) m += e.a;
+            if (m < e.keep_min or e.keep_max < m) return 0;
+            if (e.sat_min <= m and m <= e.sat_max) m = SAT;
+        }
+        // finished rows are decided here, so their slots are freed
+        for (int k = leave_ptr[i]; k < leave_ptr[i + 1]; ++k) {
+            mate[leave_slot[k]] = 0;
+        }
         return (level > 1 ? level - 1 : -1);
     }
 };
@@ -0,0 +1,278 @@
+#ifndef SAPPORO_TDZDD_APPS_PATH_SPEC_HPP
+#define SAPPORO_TDZDD_APPS_PATH_SPEC_HPP
+
+#include <vector>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <cassert>
+#include <tdzdd/DdSpec.hpp>
+#include "graph_data.hpp"
+#include "degree_spec.hpp"
+
+namespace sapporo_tdzdd_apps {
+
+/*****
+ * class MateSpecBase<T>
+ *      Simpath-style mate array shared by PathSpec and CycleSpec.
+ *      For the vertex at frontier index i, mate[i] is INIT (degree 0),
+ *      INTERIOR (degree 2), or, for an end of a partial path (degree 1),
+ *      the frontier index of the other end. S_END and T_END stand for
+ *      the other end s or t after it has left the frontier.
+ *      mate[F] is set once the path or the cycle is closed; after that,
+ *      no edge may be taken (only vertex items follow, if with_vertex).
+ *      Ends whose vertex has no edge left are cut at once
+ *      (see make_remaining_degree_table).
+ *      T must hold every value in [0, max_frontier_size() + 4].
+ *****/
+template<typename T>
+class MateSpecBase {
+protected:
+    const Graph& G;
+    const int F;
+    const bool with_vertex;
+
+    const T INIT = std::numeric_limits<T>::max();
+    const T INTERIOR = INIT - 1;
+    const T S_END = INIT - 2;
+    const T T_END = INIT - 3;
+
+    std::vector<int> rest;
+
+    int degree(const T* mate, int i) const {
+        return (mate[i] == INIT ? 0 : mate[i] == INTERIOR ? 2 : 1);
+    }
+
+    // take an edge between the ends (or isolated vertices) at ui and vi
+    // of two different paths, and return the ends of the merged path
+    std::pair<T, T> join(T* mate, int ui, int vi) const {
+        T a = (mate[ui] == INIT ? T(ui) : mate[ui]);
+        T b = (mate[vi] == INIT ? T(vi) : mate[vi]);
+        if (mate[ui] != INIT) mate[ui] = INTERIOR;
+        if (mate[vi] != INIT) mate[vi] = INTERIOR;
+        if ((long long)a < F) mate[a] = b;
+        if ((long long)b < F) mate[b] = a;
+        return std::make_pair(a, b);
+    }
+
+    // true if no frontier vertex but a and b is an end of a path
+    bool no_other_ends(const T* mate, int a, int b) const {
+        for (int i = 0; i < F; ++i) {
+            if (i == a or i == b) continue;
+            if (degree(mate, i) == 1) return false;
+        }
+        return true;
+    }
+
+    bool all_init(const T* mate) const {
+        for (int i = 0; i < F; ++i) if (mate[i] != INIT) return false;
+        return true;
+    }
+
+public:
+    MateSpecBase(
+        const Graph& G,
+        bool with_vertex
+    ) : G(G), F(G.max_frontier_size()), with_vertex(with_vertex),
+        rest(make_remaining_degree_table(G))
+    {
+        assert(F + 4 <= (long long)std::numeric_limits<T>::max());
+    }
+};
+
+/*****
+ * class PathSpec<T=int>
+ *      Simple s-t paths in one mate array. s != t is required
+ *      (tdzdd_st_paths handles s == t without it).
+ *      The ends of every partial path are s, t, or vertices that still
+ *      have edges to come; a path closing into a cycle is cut at once.
+ *****/
+template<typename T = int>
+class PathSpec :
+    public tdzdd::PodArrayDdSpec<PathSpec<T>, T, 2>,
+    public MateSpecBase<T> {
+private:
+    typedef MateSpecBase<T> Base;
+    using Base::G;
+    using Base::F;
+    using Base::with_vertex;
+    using Base::INIT;
+    using Base::INTERIOR;
+    using Base::S_END;
+    using Base::T_END;
+    using Base::rest;
+
+    const int s, t;
+    const int s_index, t_index;
+    // items in which s (t) is on the frontier
+    int s_begin, s_end, t_begin, t_end;
+
+    bool is_terminal(int v) const {
+        return v == s or v == t;
+    }
+
+    // whether the end x at item i is s (is_s = true) or t
+    bool is_end_of(T x, int i, bool is_s) const {
+        if (x == (is_s ? S_END : T_END)) return true;
+        int index = (is_s ? s_index : t_index);
+        int begin = (is_s ? s_begin : t_begin), end = (is_s ? s_end : t_end);
+        return (long long)x == index and begin <= i and i < end;
+    }
+
+    // false if v (at index vi) can no longer reach its degree
+    bool can_finish(const T* mate, int i, int j, int v, int vi) const {
+        int d = this->degree(mate, vi);
+        int need = (is_terminal(v) ? 1 - d : d % 2);
+        return need <= rest[2 * i + j];
+    }
+
+public:
+    PathSpec(
+        const Graph& G,
+        int s,
+        int t,
+        bool with_vertex = false
+    ) : Base(G, with_vertex), s(s), t(t),
+        s_index(G.frontier_index(s)), t_index(G.frontier_index(t))
+    {
+        assert(s != t);
+        s_begin = t_begin = G.n_items();
+        for (int i = 0; i < G.n_items(); ++i) {
+            if (G.is_vertex(i)) continue;
+            for (int v : {G.item_v0(i), G.item_v1(i)}) {
+                if (v == s) s_begin = std::min(s_begin, i);
+                if (v == t) t_begin = std::min(t_begin, i);
+            }
+        }
+        s_end = G.var_of_vertex(s);
+        t_end = G.var_of_vertex(t);
+        this->setArraySize(F + 1);
+    }
+
+    int getRoot(T* mate) const {
+        for (int i = 0; i < F; ++i) mate[i] = INIT;
+        mate[F] = 0;
+        return G.n_items();
+    }
+
+    int getChild(T* mate, int level, bool take) const {
+        int i = G.n_items() - level;
+
+        if (G.is_vertex(i)) {
+            if (take and not with_vertex) return 0;
+            // the vertex of item i leaves frontier
+            int v = G.item_v0(i);
+            int vi = G.frontier_index(v);
+            if (with_vertex and take != (mate[vi] != INIT)) return 0;
+            int d = this->degree(mate, vi);
+            if (is_terminal(v)) {
+                if (d != 1) return 0;
+                if ((long long)mate[vi] < F) mate[mate[vi]] = (v == s ? S_END : T_END);
+            }
+            else if (d == 1) return 0;
+            mate[vi] = INIT;
+            if (mate[F] and this->all_init(mate)) return -1;
+        }
+        else {
+            int u = G.item_v0(i), v = G.item_v1(i);
+            int ui = G.frontier_index(u), vi = G.frontier_index(v);
+            if (take) {
+                if (mate[F]) return 0;
+                int du = this->degree(mate, ui), dv = this->degree(mate, vi);
+                if (du + 1 > (is_terminal(u) ? 1 : 2)) return 0;
+                if (dv + 1 > (is_terminal(v) ? 1 : 2)) return 0;
+                if (du == 1 and (long long)mate[ui] == vi) return 0; // cycle
+                std::pair<T, T> ends = this->join(mate, ui, vi);
+                T a = ends.first, b = ends.second;
+                if ((is_end_of(a, i, true) and is_end_of(b, i, false))
+                    or (is_end_of(a, i, false) and is_end_of(b, i, true))) {
+                    if (not this->no_other_ends(mate, a, b)) return 0;
+                    if (not with_vertex) return -1;
+                    mate[F] = 1;
+                }
+            }
+            if (not mate[F]) {
+                if (not can_finish(mate, i, 0, u, ui)) return 0;
+                if (not can_finish(mate, i, 1, v, vi)) return 0;
+            }
+        }
+
+        return level - 1;
+    }
+};
+
+/*****
+ * class CycleSpec<T=int>
+ *      Single cycles (including two parallel edges) in one mate array.
+ *****/
+template<typename T = int>
+class CycleSpec :
+    public tdzdd::PodArrayDdSpec<CycleSpec<T>, T, 2>,
+    public MateSpecBase<T> {
+private:
+    typedef MateSpecBase<T> Base;
+    using Base::G;
+    using Base::F;
+    using Base::with_vertex;
+    using Base::INIT;
+    using Base::INTERIOR;
+    using Base::rest;
+
+public:
+    CycleSpec(
+        const Graph& G,
+        bool with_vertex = false
+    ) : Base(G, with_vertex)
+    {
+        this->setArraySize(F + 1);
+    }
+
+    int getRoot(T* mate) const {
+        for (int i = 0; i < F; ++i) mate[i] = INIT;
+        mate[F] = 0;
+        return G.n_items();
+    }
+
+    int getChild(T* mate, int level, bool take) const {
+        int i = G.n_items() - level;
+
+        if (G.is_vertex(i)) {
+            if (take and not with_vertex) return 0;
+            // the vertex of item i leaves frontier
+            int vi = G.frontier_index(G.item_v0(i));
+            if (with_vertex and take != (mate[vi] != INIT)) return 0;
+            if (this->degree(mate, vi) == 1) return 0;
+            mate[vi] = INIT;
+            if (mate[F] and this->all_init(mate)) return -1;
+        }
+        else {
+            int u = G.item_v0(i), v = G.item_v1(i);
+            int ui = G.frontier_index(u), vi = G.frontier_index(v);
+            if (take) {
+                if (mate[F]) return 0;
+                int du = this->degree(mate, ui), dv = this->degree(mate, vi);
+                if (du == 2 or dv == 2) return 0;
+                if (du == 1 and (long long)mate[ui] == vi) {
+                    // close the cycle
+                    if (not this->no_other_ends(mate, ui, vi)) return 0;
+                    if (not with_vertex) return -1;
+                    mate[ui] = mate[vi] = INTERIOR;
+                    mate[F] = 1;
+                }
+                else {
+                    this->join(mate, ui, vi);
+                }
+            }
+            if (not mate[F]) {
+                if (this->degree(mate, ui) == 1 and rest[2 * i] == 0) return 0;
+                if (this->degree(mate, vi) == 1 and rest[2 * i + 1] == 0) return 0;
+            }
+        }
+
+        return level - 1;
+    }
+};
+
+} // namespace sapporo_tdzdd_apps
+
+#endif
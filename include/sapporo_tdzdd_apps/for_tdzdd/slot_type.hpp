@@ -0,0 +1,30 @@
+#ifndef SAPPORO_TDZDD_APPS_SLOT_TYPE_HPP
+#define SAPPORO_TDZDD_APPS_SLOT_TYPE_HPP
+
+#include <cstdint>
+#include <limits>
+
+namespace sapporo_tdzdd_apps {
+
+/*****
+ * with_slot_type(max_value, func)
+ *      Call func(T()) with the narrowest unsigned integer type T
+ *      among uint8_t, uint16_t and uint32_t that can hold every value
+ *      in [0, max_value], and return its result.
+ *      Used to choose the array element type of frontier-based specs,
+ *      whose states are hashed and stored for every DD node.
+ *****/
+template<typename Func>
+auto with_slot_type(long long max_value, Func func) {
+    if (max_value <= std::numeric_limits<uint8_t>::max()) {
+        return func(uint8_t());
+    }
+    if (max_value <= std::numeric_limits<uint16_t>::max()) {
+        return func(uint16_t());
+    }
+    return func(uint32_t());
+}
+
+} // namespace sapporo_tdzdd_apps
+
+#endif
@@ -0,0 +1,366 @@
+#ifndef SAPPORO_TDZDD_APPS_INSTANCE_LOADER_HPP
+#define SAPPORO_TDZDD_APPS_INSTANCE_LOADER_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <climits>
+#include <cstring>
+#include <cstdint>
+#include "persistence.hpp"
+#include "for_tdzdd/graph_data.hpp"
+#include "for_tdzdd/linear_spec.hpp"
+
+namespace sapporo_tdzdd_apps {
+
+/*****
+ * class TextScanner
+ *      Whitespace-separated tokens of a character range (e.g. a mapped
+ *      file), scanned in place without copying or locale lookups.
+ *      next_int and next_word throw std::runtime_error on bad input.
+ *****/
+class TextScanner {
+private:
+    const char* p;
+    const char* end;
+
+    static bool is_space(char c) {
+        return c == ' ' or c == '\n' or c == '\t' or c == '\r'
+               or c == '\f' or c == '\v';
+    }
+
+    void skip_space() {
+        while (p < end and is_space(*p)) ++p;
+    }
+
+public:
+    TextScanner(const char* begin, const char* end) : p(begin), end(end) {}
+
+    bool at_end() {
+        skip_space();
+        return p == end;
+    }
+
+    // number of characters not scanned yet
+    size_t remaining() const {
+        return end - p;
+    }
+
+    // true if the next token starts with a letter (a keyword such as graph)
+    bool next_is_word() {
+        skip_space();
+        return p < end and ((*p | 0x20) >= 'a' and (*p | 0x20) <= 'z');
+    }
+
+    int next_int() {
+        skip_space();
+        bool neg = false;
+        if (p < end and (*p == '-' or *p == '+')) neg = (*p++ == '-');
+        if (p == end or *p < '0' or *p > '9') {
+            throw std::runtime_error("integer expected");
+        }
+        long long x = 0;
+        while (p < end and *p >= '0' and *p <= '9') {
+            x = 10 * x + (*p++ - '0');
+            if (x > (long long)INT_MAX + 1) throw std::runtime_error("integer overflow");
+        }
+        // a token such as 12abc or 3.5 is not an integer
+        if (p < end and not is_space(*p)) throw std::runtime_error("integer expected");
+        if (neg) x = -x;
+        if (x > INT_MAX) throw std::runtime_error("integer overflow");
+        return x;
+    }
+
+    std::string next_word() {
+        skip_space();
+        const char* begin = p;
+        while (p < end and not is_space(*p)) ++p;
+        if (begin == p) throw std::runtime_error("word expected");
+        return std::string(begin, p);
+    }
+};
+
+/*****
+ * struct LinearSystem
+ *      Linear inequalities Ax sign b over n_vars 0-1 variables, with A
+ *      kept sparse (A.n_cols = n_vars) as taken by the CsrMatrix version
+ *      of tdzdd_linear_inequalities. dense_A() builds the dense matrix
+ *      for the other version, in O(n_rows * n_vars) time and memory.
+ *****/
+struct LinearSystem {
+    int n_vars = 0;
+    CsrMatrix A;
+    std::vector<std::string> sign;
+    std::vector<int> b;
+
+    std::vector<std::vector<int>> dense_A() const {
+        std::vector<std::vector<int>> D(A.n_rows, std::vector<int>(n_vars, 0));
+        for (int r = 0; r < A.n_rows; ++r) {
+            for (int k = A.row_ptr[r]; k < A.row_ptr[r + 1]; ++k) {
+                D[r][A.col_index[k]] += A.value[k];
+            }
+        }
+        return D;
+    }
+};
+
+/*****
+ * Binary instance formats (version 2, native byte order)
+ *      Graph:  InstanceFileHeader (magic "STZGRAPH", n_cols = |V|,
+ *              n_rows = |E|, nnz = 0), int32 v0[|E|], int32 v1[|E|],
+ *              where every vertex is in [0, |V|).
+ *      System: InstanceFileHeader (magic "STZINEQS", n_cols = n_vars,
+ *              n_rows, nnz), then A in CSR form uint64 row_ptr[n_rows + 1],
+ *              int32 col_index[nnz], int32 value[nnz], int32 b[n_rows],
+ *              int8 sign[n_rows] (-1: <=, 0: =, 1: >=).
+ *      Arrays follow each other without padding; every one starts
+ *      at a multiple of its element size.
+ *      Version 2 stores |V| of a graph (0 in version 1).
+ *****/
+struct InstanceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t n_cols;
+    uint64_t n_rows;
+    uint64_t nnz;
+};
+
+const char GRAPH_FILE_MAGIC[8] = {'S', 'T', 'Z', 'G', 'R', 'A', 'P', 'H'};
+const char SYSTEM_FILE_MAGIC[8] = {'S', 'T', 'Z', 'I', 'N', 'E', 'Q', 'S'};
+const uint32_t INSTANCE_FILE_VERSION = 2;
+
+/*****
+ * load_graph(path)
+ *      Load a graph and set it up (Graph::setup()). The file is either
+ *      binary (see save_graph_binary) or text:
+ *          [graph] n m
+ *          v0 v1      (m lines)
+ *      as read_graph in test/instance_reader.hpp. n counts the vertices,
+ *      which need not be numbered from 0 (see dataset/sample_graph.txt),
+ *      so vertex numbers must be below n + 2m: the edges name at most 2m
+ *      vertices, and the per-vertex arrays of Graph stay linear in the
+ *      header. In a binary file, vertex numbers must be below |V|.
+ *      Edges are added in one bulk call.
+ *      Throw std::runtime_error if the file is broken; the sizes are
+ *      checked against the file before anything is sized by them.
+ *****/
+Graph load_graph(const std::string& path) {
+    MappedFile file(path);
+    std::vector<int> v0, v1;
+    long long vertex_bound = 0;
+    auto fail = [&](const std::string& msg) {
+        throw std::runtime_error(path + ": " + msg);
+    };
+
+    InstanceFileHeader h;
+    if (file.size() >= sizeof(h)
+        and std::memcmp(file.data(), GRAPH_FILE_MAGIC, 8) == 0) {
+        std::memcpy(&h, file.data(), sizeof(h));
+        if (h.version != INSTANCE_FILE_VERSION) fail("unsupported version");
+        if (h.n_cols > INT_MAX or h.n_rows > INT_MAX) fail("too large");
+        vertex_bound = h.n_cols;
+        if (sizeof(h) + 2 * sizeof(int32_t) * h.n_rows > file.size()) fail("truncated");
+        const int32_t* data = (const int32_t*)(file.data() + sizeof(h));
+        v0.assign(data, data + h.n_rows);
+        v1.assign(data + h.n_rows, data + 2 * h.n_rows);
+    }
+    else {
+        try {
+            TextScanner sc(file.data(), file.data() + file.size());
+            if (sc.next_is_word()) sc.next_word();
+            int n = sc.next_int();
+            int m = sc.next_int();
+            if (n < 0 or m < 0) throw std::runtime_error("negative size");
+            vertex_bound = (long long)n + 2LL * m;
+            // an edge takes at least 4 characters (" u v" with a space before)
+            if ((size_t)m > sc.remaining() / 4) {
+                throw std::runtime_error("more edges than the file can hold");
+            }
+            v0.resize(m);
+            v1.resize(m);
+            for (int i = 0; i < m; ++i) {
+                v0[i] = sc.next_int();
+                v1[i] = sc.next_int();
+            }
+        }
+        catch (const std::runtime_error& e) {
+            fail(e.what());
+        }
+    }
+    for (size_t k = 0; k < v0.size(); ++k) {
+        if (v0[k] < 0 or v1[k] < 0 or v0[k] == v1[k]
+            or v0[k] >= vertex_bound or v1[k] >= vertex_bound) {
+            fail("bad edge");
+        }
+    }
+
+    Graph G;
+    G.add_edges(v0, v1);
+    G.setup();
+    return G;
+}
+
+/*****
+ * save_graph_binary(path, G)
+ *      Write the edges of G in the binary graph format.
+ *****/
+void save_graph_binary(const std::string& path, const Graph& G) {
+    int m = G.n_edges();
+    std::vector<int32_t> data(2 * m);
+    for (int i = 0; i < m; ++i) {
+        std::pair<int, int> e = G.edge(i);
+        data[i] = e.first;
+        data[m + i] = e.second;
+    }
+
+    InstanceFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, GRAPH_FILE_MAGIC, 8);
+    h.version = INSTANCE_FILE_VERSION;
+    h.n_cols = G.max_vertex_number() + 1;
+    h.n_rows = m;
+
+    std::ofstream os(path, std::ios::binary);
+    os.write((const char*)&h, sizeof(h));
+    os.write((const char*)data.data(), sizeof(int32_t) * data.size());
+    if (not os) throw std::runtime_error("cannot write " + path);
+}
+
+/*****
+ * load_linear_system(path)
+ *      Load linear inequalities, either binary (see
+ *      save_linear_system_binary) or text:
+ *          [ineq] n_vars n_rows
+ *          a_1 ... a_n_vars sign b      (n_rows lines, sign: <=, >=, =)
+ *      as read_linear_inequalities in test/instance_reader.hpp.
+ *      Only the nonzeros of A are kept, so a binary file loads in
+ *      O(n_rows + nnz) time and memory.
+ *      Throw std::runtime_error if the file is broken; n_rows is checked
+ *      against the file before anything is sized by it.
+ *****/
+LinearSystem load_linear_system(const std::string& path) {
+    MappedFile file(path);
+    LinearSystem sys;
+    auto fail = [&](const std::string& msg) {
+        throw std::runtime_error(path + ": " + msg);
+    };
+
+    InstanceFileHeader h;
+    if (file.size() >= sizeof(h)
+        and std::memcmp(file.data(), SYSTEM_FILE_MAGIC, 8) == 0) {
+        std::memcpy(&h, file.data(), sizeof(h));
+        if (h.version != INSTANCE_FILE_VERSION) fail("unsupported version");
+        if (h.n_cols > INT_MAX or h.n_rows > INT_MAX or h.nnz > INT_MAX) {
+            fail("too large");
+        }
+        uint64_t row_pos = sizeof(h);
+        uint64_t col_pos = row_pos + sizeof(uint64_t) * (h.n_rows + 1);
+        uint64_t val_pos = col_pos + sizeof(int32_t) * h.nnz;
+        uint64_t b_pos = val_pos + sizeof(int32_t) * h.nnz;
+        uint64_t sign_pos = b_pos + sizeof(int32_t) * h.n_rows;
+        if (sign_pos + h.n_rows > file.size()) fail("truncated");
+
+        const uint64_t* row_ptr = (const uint64_t*)(file.data() + row_pos);
+        const int32_t* col = (const int32_t*)(file.data() + col_pos);
+        const int32_t* val = (const int32_t*)(file.data() + val_pos);
+        const int32_t* b = (const int32_t*)(file.data() + b_pos);
+        const int8_t* sign = (const int8_t*)(file.data() + sign_pos);
+
+        sys.n_vars = h.n_cols;
+        sys.A.n_rows = h.n_rows;
+        sys.A.n_cols = h.n_cols;
+        sys.A.row_ptr.assign(row_ptr, row_ptr + h.n_rows + 1);
+        sys.A.col_index.assign(col, col + h.nnz);
+        sys.A.value.assign(val, val + h.nnz);
+        sys.b.assign(b, b + h.n_rows);
+        sys.sign.resize(h.n_rows);
+        if (row_ptr[0] != 0 or row_ptr[h.n_rows] != h.nnz) fail("bad row pointers");
+        for (uint64_t r = 0; r < h.n_rows; ++r) {
+            if (row_ptr[r] > row_ptr[r + 1]) fail("bad row pointers");
+            if (sign[r] < -1 or sign[r] > 1) fail("bad sign");
+            sys.sign[r] = (sign[r] < 0 ? "<=" : sign[r] > 0 ? ">=" : "=");
+        }
+        for (uint64_t k = 0; k < h.nnz; ++k) {
+            if (col[k] < 0 or (uint64_t)col[k] >= h.n_cols) fail("bad column");
+        }
+        return sys;
+    }
+
+    try {
+        TextScanner sc(file.data(), file.data() + file.size());
+        if (sc.next_is_word()) sc.next_word();
+        sys.n_vars = sc.next_int();
+        int n_rows = sc.next_int();
+        if (sys.n_vars < 0 or n_rows < 0) {
+            throw std::runtime_error("negative size");
+        }
+        // a row takes at least 2 characters per token (n_vars + 2 tokens)
+        if ((size_t)n_rows > sc.remaining() / (2 * ((size_t)sys.n_vars + 2))) {
+            throw std::runtime_error("more rows than the file can hold");
+        }
+        sys.A.n_rows = n_rows;
+        sys.A.n_cols = sys.n_vars;
+        sys.A.row_ptr.assign(1, 0);
+        sys.sign.resize(n_rows);
+        sys.b.resize(n_rows);
+        for (int r = 0; r < n_rows; ++r) {
+            for (int i = 0; i < sys.n_vars; ++i) {
+                int a = sc.next_int();
+                if (a == 0) continue;
+                sys.A.col_index.push_back(i);
+                sys.A.value.push_back(a);
+            }
+            if (sys.A.col_index.size() > INT_MAX) {
+                throw std::runtime_error("too many nonzeros");
+            }
+            sys.A.row_ptr.push_back(sys.A.col_index.size());
+            sys.sign[r] = sc.next_word();
+            if (sys.sign[r] != "<=" and sys.sign[r] != ">=" and sys.sign[r] != "=") {
+                throw std::runtime_error("bad sign " + sys.sign[r]);
+            }
+            sys.b[r] = sc.next_int();
+        }
+    }
+    catch (const std::runtime_error& e) {
+        fail(e.what());
+    }
+    return sys;
+}
+
+/*****
+ * save_linear_system_binary(path, sys)
+ *      Write sys in the binary system format, with the nonzeros of
+ *      sys.A as they are.
+ *****/
+void save_linear_system_binary(const std::string& path, const LinearSystem& sys) {
+    const CsrMatrix& M = sys.A;
+    int n_rows = M.n_rows;
+    std::vector<uint64_t> row_ptr(M.row_ptr.begin(), M.row_ptr.end());
+    std::vector<int8_t> sign(n_rows);
+    for (int r = 0; r < n_rows; ++r) {
+        sign[r] = (sys.sign[r] == "<=" ? -1 : sys.sign[r] == ">=" ? 1 : 0);
+    }
+
+    InstanceFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, SYSTEM_FILE_MAGIC, 8);
+    h.version = INSTANCE_FILE_VERSION;
+    h.n_cols = sys.n_vars;
+    h.n_rows = n_rows;
+    h.nnz = M.col_index.size();
+
+    std::ofstream os(path, std::ios::binary);
+    os.write((const char*)&h, sizeof(h));
+    os.write((const char*)row_ptr.data(), sizeof(uint64_t) * row_ptr.size());
+    os.write((const char*)M.col_index.data(), sizeof(int32_t) * h.nnz);
+    os.write((const char*)M.value.data(), sizeof(int32_t) * h.nnz);
+    os.write((const char*)sys.b.data(), sizeof(int32_t) * n_rows);
+    os.write((const char*)sign.data(), n_rows);
+    if (not os) throw std::runtime_error("cannot write " + path);
+}
+
+} // namespace sapporo_tdzdd_apps
+
+#endif
@@ -5,10 +5,17 @@
 #include <string>
 #include <limits>
 #include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <algorithm>
+#include <cassert>
 #include <tdzdd/DdStructure.hpp>
 #include <tdzdd/dd/NodeTable.hpp>
 #include "converter.hpp"
+#include "semiring.hpp"
 #include "for_sapporo/ext_operations.hpp"
+#include "for_sapporo/memory_manager.hpp"
 
 namespace sapporo_tdzdd_apps {
 
@@ -16,67 +23,113 @@ class OptimizationBase {
 protected:
     int n;
     tdzdd::DdStructure<2> dd;
+    FlatDiagram fd;
+    bool use_mp = false;
 
 public:
     OptimizationBase() {}
 
+    /*****
+     * set_use_mp(flag)
+     *      If flag = true, the nodes of each level are evaluated
+     *      in parallel by OpenMP (compile with -fopenmp).
+     *****/
+    void set_use_mp(bool flag) {
+        use_mp = flag;
+    }
+
     void set_dd(const ZBDD& f) {
-        dd = to_ddstructure(f);
-        n = dd.topLevel();
-        check_sapporo_vars(n);
+        set_dd(to_ddstructure(f));
     }
 
     void set_dd(const tdzdd::DdStructure<2>& f) {
         dd = f;
+        fd = FlatDiagram(dd);
         n = dd.topLevel();
         check_sapporo_vars(n);
     }
+
+    /*****
+     * set_diagram(f)
+     *      Optimize over a FlatDiagram, e.g. one mapped by load_diagram,
+     *      without a DdStructure.
+     *****/
+    void set_diagram(const FlatDiagram& f) {
+        dd = tdzdd::DdStructure<2>();
+        fd = f;
+        n = fd.top_level();
+        check_sapporo_vars(n);
+    }
 };
 
+/*****
+ * class LinearOptimization<T>
+ *      optimize(cost, direction) runs in two passes. compute_best
+ *      evaluates the MaxPlus or MinPlus semiring over the FlatDiagram
+ *      (see semiring.hpp), split across threads per level with use_mp;
+ *      mark_optimal then marks, top-down from the root, the nodes reached
+ *      through optimal edges, and the ZBDD of optimal sets is built only
+ *      over the marked nodes. optimize_single follows one optimal edge
+ *      per level and returns an index vector without using SAPPOROBDD.
+ *****/
 template<typename T> class LinearOptimization : public OptimizationBase {
-private:
-    std::pair<T, ZBDD> bottom_up_dp(const std::vector<int>& cost, int dir) {
-        auto func = [&](T a, T b) {
-            if (dir > 0) return std::max(a, b);
-            else return std::min(a, b);
-        };
-        
-        const tdzdd::NodeTableHandler<2>& diagram = dd.getDiagram();
-        std::vector<std::vector<T>> best(n + 1, std::vector<T>());
-        std::vector<std::vector<ZBDD>> ans(n + 1, std::vector<ZBDD>());
-        for (int i = 0; i <= n; ++i) {
-            int w = (*diagram)[i].size();
-            if (dir > 0) best[i].assign(w, std::numeric_limits<T>().min());
-            if (dir < 0) best[i].assign(w, std::numeric_limits<T>().max());
-            ans[i].assign(w, ZBDD(0));
-        }
-        best[0][1] = 0;
-        ans[0][1] = ZBDD(1);
-        
-        for (int i = 1; i <= n; ++i) {
-            int w = (*diagram)[i].size();
-            for (int j = 0; j < w; ++j) {
-                // update best value
+protected:
+    std::vector<T> best;
+    std::vector<int> cost;
+
+    void compute_best(const std::vector<int>& cost, int dir) {
+        this->cost = cost;
+        std::vector<T> weight(cost.begin(), cost.end());
+        if (dir > 0) best = semiring_values<MaxPlus<T>>(fd, {}, weight, use_mp);
+        else best = semiring_values<MinPlus<T>>(fd, {}, weight, use_mp);
+    }
+
+    // return true if edge b of node v at level i is on an optimal path
+    bool is_optimal_edge(size_t v, int i, int b) const {
+        uint32_t c = fd.child(v, b);
+        if (c == 0) return false;
+        T val = best[c] + (b == 1 ? cost[n - i] : 0);
+        return val == best[v];
+    }
+
+    std::vector<char> mark_optimal() const {
+        std::vector<char> marked(fd.size(), 0);
+        marked[fd.root()] = 1;
+        for (int i = n; i >= 1; --i) {
+            for (size_t v = fd.level_begin(i); v < fd.level_end(i); ++v) {
+                if (not marked[v]) continue;
                 for (int b = 0; b < 2; ++b) {
-                    tdzdd::NodeId node = diagram->child(i, j, b);
-                    int r = node.row(), c = node.col();
-                    if (r == 0 and c == 0) continue;
-                    T val = best[r][c] + (b == 1 ? cost[n - i] : 0);
-                    best[i][j] = func(best[i][j], val);
+                    if (is_optimal_edge(v, i, b)) marked[fd.child(v, b)] = 1;
                 }
-                // restore optimal solutions
+            }
+        }
+        return marked;
+    }
+
+    std::pair<T, ZBDD> bottom_up_dp(const std::vector<int>& cost, int dir) {
+        compute_best(cost, dir);
+        std::vector<char> marked = mark_optimal();
+        size_t n_marked = std::count(marked.begin(), marked.end(), 1);
+        SapporoMemoryManager::instance().reserve(
+            2 * n_marked, "LinearOptimization::optimize");
+
+        std::vector<ZBDD> ans(fd.size(), ZBDD(0));
+        ans[1] = ZBDD(1);
+        for (int i = 1; i <= n; ++i) {
+            for (size_t v = fd.level_begin(i); v < fd.level_end(i); ++v) {
+                if (not marked[v]) continue;
+                ZBDD f(0);
                 for (int b = 0; b < 2; ++b) {
-                    tdzdd::NodeId node = diagram->child(i, j, b);
-                    int r = node.row(), c = node.col();
-                    if (r == 0 and c == 0) continue;
-                    T val = best[r][c] + (b == 1 ? cost[n - i] : 0);
-                    if (best[i][j] > val) continue;
-                    ans[i][j] += (b == 0 ? ans[r][c] : ans[r][c].Change(i));
+                    if (not is_optimal_edge(v, i, b)) continue;
+                    const ZBDD& g = ans[fd.child(v, b)];
+                    f += (b == 0 ? g : g.Change(i));
                 }
+                ans[v] = f;
             }
         }
-        
-        return std::pair<T, ZBDD>(best[n][0], ans[n][0]);
+
+        SapporoMemoryManager::instance().record();
+        return std::pair<T, ZBDD>(best[fd.root()], ans[fd.root()]);
     }
 
 public:
@@ -88,6 +141,326 @@ public:
     ) {
         return bottom_up_dp(cost, direction == "maximize" ? 1 : -1);
     }
+
+    /*****
+     * optimize_single(cost, direction="maximize")
+     *      Return the optimal value and one optimal subset, whose items
+     *      are in the same numbering as unfold_ddstructure (ascending).
+     *      The subset is empty if the family is empty.
+     *****/
+    std::pair<T, std::vector<int>> optimize_single(
+        const std::vector<int>& cost,
+        std::string direction = "maximize"
+    ) {
+        compute_best(cost, direction == "maximize" ? 1 : -1);
+
+        size_t v = fd.root();
+        std::vector<int> items;
+        while (v >= 2) {
+            int i = fd.level_of(v);
+            // prefer the 1-edge on ties
+            int b = (is_optimal_edge(v, i, 1) ? 1 : 0);
+            if (b == 1) items.push_back(n - i);
+            v = fd.child(v, b);
+        }
+        return std::make_pair(best[fd.root()], items);
+    }
+};
+
+/*****
+ * class RankedOptimization<T>
+ *      Enumerate subsets one by one in order of cost (nonincreasing for
+ *      "maximize", nondecreasing for "minimize"), in the manner of
+ *      Eppstein's k shortest paths. After the best values are computed,
+ *      every node has one optimal (tree) edge, and its other edge is a
+ *      sidetrack with a nonnegative loss. A solution is the tree path
+ *      from the root with some sidetracks taken. heap[v] is a persistent
+ *      leftist heap of the sidetracks on the tree path from v, sharing
+ *      structure with the heap of v's tree child, and next() pops the
+ *      candidate with the least total loss and pushes at most three
+ *      successors, so k solutions take O(k log k) time besides O(n)
+ *      per solution for walking its path and writing it out.
+ *
+ *      RankedOptimization<int> ranked;
+ *      ranked.set_dd(dd);
+ *      ranked.prepare(cost, "minimize");
+ *      std::pair<int, std::vector<int>> sol;
+ *      while (ranked.next(sol)) { ... }
+ *****/
+template<typename T> class RankedOptimization : public LinearOptimization<T> {
+private:
+    typedef LinearOptimization<T> Base;
+    using Base::n;
+    using Base::fd;
+    using Base::best;
+    using Base::cost;
+
+    struct HeapNode {
+        T key;      // loss of the sidetrack
+        int node;   // tail of the sidetrack
+        int left;
+        int right;
+        int rank;
+    };
+
+    struct Step {
+        int node;   // sidetrack taken
+        int prev;   // previous step, or -1
+    };
+
+    struct Candidate {
+        T loss;
+        int heap;   // heap node to take next
+        int path;   // steps before it, or -1
+        bool operator<(const Candidate& o) const { return loss > o.loss; }
+    };
+
+    int dir;
+    std::vector<char> tree_edge;    // optimal edge of each node
+    std::vector<int> heap;          // heap root of each node, or -1
+    std::vector<HeapNode> pool;
+    std::vector<Step> steps;
+    std::priority_queue<Candidate> queue;
+    std::vector<int> side;          // sidetrack node of each level, or -1
+    bool first;
+
+    T loss_of(int v, T val) const {
+        return (dir > 0 ? best[v] - val : val - best[v]);
+    }
+
+    int rank_of(int h) const { return (h < 0 ? 0 : pool[h].rank); }
+
+    // persistent merge of leftist heaps a and b
+    int merge(int a, int b) {
+        if (a < 0) return b;
+        if (b < 0) return a;
+        if (pool[b].key < pool[a].key) std::swap(a, b);
+        HeapNode h = pool[a];
+        h.right = merge(h.right, b);
+        if (rank_of(h.left) < rank_of(h.right)) std::swap(h.left, h.right);
+        h.rank = rank_of(h.right) + 1;
+        pool.push_back(h);
+        return pool.size() - 1;
+    }
+
+    // the sidetracks of a solution are at distinct levels of its path,
+    // so side[i] marks the one at level i and is cleared afterwards
+    std::vector<int> restore(int path) {
+        for (int q = path; q >= 0; q = steps[q].prev) {
+            side[fd.level_of(steps[q].node)] = steps[q].node;
+        }
+        std::vector<int> items;
+        size_t v = fd.root();
+        while (v >= 2) {
+            int i = fd.level_of(v);
+            int b = tree_edge[v] ^ (side[i] == (int)v);
+            if (b == 1) items.push_back(n - i);
+            v = fd.child(v, b);
+        }
+        for (int q = path; q >= 0; q = steps[q].prev) {
+            side[fd.level_of(steps[q].node)] = -1;
+        }
+        return items;
+    }
+
+public:
+    RankedOptimization() {}
+
+    /*****
+     * prepare(cost, direction="maximize")
+     *      Compute the best values, tree edges and sidetrack heaps,
+     *      and reset the enumeration.
+     *****/
+    void prepare(
+        const std::vector<int>& cost,
+        std::string direction = "maximize"
+    ) {
+        this->dir = (direction == "maximize" ? 1 : -1);
+        this->compute_best(cost, dir);
+
+        tree_edge.assign(fd.size(), 0);
+        heap.assign(fd.size(), -1);
+        pool.clear();
+        steps.clear();
+        queue = std::priority_queue<Candidate>();
+        side.assign(n + 1, -1);
+        first = true;
+
+        for (int i = 1; i <= n; ++i) {
+            for (size_t v = fd.level_begin(i); v < fd.level_end(i); ++v) {
+                int t = (this->is_optimal_edge(v, i, 1) ? 1 : 0);
+                tree_edge[v] = t;
+                heap[v] = heap[fd.child(v, t)];
+                uint32_t g = fd.child(v, 1 - t);
+                if (g == 0) continue;
+                T val = best[g] + (t == 0 ? cost[n - i] : 0);
+                pool.push_back(HeapNode{loss_of(v, val), (int)v, -1, -1, 1});
+                heap[v] = merge(heap[v], pool.size() - 1);
+            }
+        }
+
+        int h = heap[fd.root()];
+        if (h >= 0) queue.push(Candidate{pool[h].key, h, -1});
+    }
+
+    /*****
+     * next(sol)
+     *      Store the next (value, subset) into sol and return true,
+     *      or return false if all subsets have been enumerated.
+     *      Subsets are in the same numbering as unfold_ddstructure.
+     *****/
+    bool next(std::pair<T, std::vector<int>>& sol) {
+        if (fd.root() == 0) return false;
+        T opt = best[fd.root()];
+        if (first) {
+            first = false;
+            sol = std::make_pair(opt, restore(-1));
+            return true;
+        }
+        if (queue.empty()) return false;
+
+        Candidate c = queue.top();
+        queue.pop();
+        const HeapNode h = pool[c.heap];
+        steps.push_back(Step{h.node, c.path});
+        int q = steps.size() - 1;
+
+        // replace the sidetrack by one of its heap children
+        for (int d : {h.left, h.right}) {
+            if (d < 0) continue;
+            queue.push(Candidate{c.loss - h.key + pool[d].key, d, c.path});
+        }
+        // or take another sidetrack after it
+        int g = heap[fd.child(h.node, 1 - tree_edge[h.node])];
+        if (g >= 0) queue.push(Candidate{c.loss + pool[g].key, g, q});
+
+        T val = (dir > 0 ? opt - c.loss : opt + c.loss);
+        sol = std::make_pair(val, restore(q));
+        return true;
+    }
+
+    /*****
+     * top_k(cost, k, direction="maximize")
+     *      Return the first k results of next() after prepare.
+     *****/
+    std::vector<std::pair<T, std::vector<int>>> top_k(
+        const std::vector<int>& cost,
+        int k,
+        std::string direction = "maximize"
+    ) {
+        prepare(cost, direction);
+        std::vector<std::pair<T, std::vector<int>>> res;
+        std::pair<T, std::vector<int>> sol;
+        while ((int)res.size() < k and next(sol)) res.push_back(sol);
+        return res;
+    }
+};
+
+/*****
+ * class BatchOptimization<T>
+ *      Optimize Q cost vectors over the same diagram in one bottom-up
+ *      pass. best[v * Q + q] is the best value of node v for cost
+ *      vector q, and costs are transposed so that the weights of one
+ *      item are contiguous, so the loop over q for each node is a plain
+ *      vectorizable loop and each node is read once per batch.
+ *
+ *      BatchOptimization<int> batch;
+ *      batch.set_dd(dd);
+ *      auto res = batch.optimize(costs, "maximize", true);
+ *****/
+template<typename T> class BatchOptimization : public OptimizationBase {
+private:
+    int Q;
+    std::vector<T> best;
+    std::vector<T> weight;  // weight[k * Q + q] = costs[q][k]
+
+    void compute_best(int dir) {
+        const T worst = (dir > 0 ? std::numeric_limits<T>::lowest()
+                                 : std::numeric_limits<T>::max());
+        best.assign(fd.size() * Q, worst);
+        for (int q = 0; q < Q; ++q) best[Q + q] = 0;
+
+#ifdef _OPENMP
+        // levels narrower than this are not worth waking threads for
+        const long long MP_MIN_WIDTH = 256;
+#endif
+        for (int i = 1; i <= n; ++i) {
+            long long begin = fd.level_begin(i), end = fd.level_end(i);
+            const T* a1 = weight.data() + (size_t)(n - i) * Q;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (use_mp and end - begin >= MP_MIN_WIDTH)
+#endif
+            for (long long v = begin; v < end; ++v) {
+                uint32_t c0 = fd.child(v, 0), c1 = fd.child(v, 1);
+                T* bv = best.data() + v * Q;
+                const T* b0 = best.data() + (size_t)c0 * Q;
+                const T* b1 = best.data() + (size_t)c1 * Q;
+                if (c1 == 0) {
+                    for (int q = 0; q < Q; ++q) bv[q] = b0[q];
+                }
+                else if (c0 == 0) {
+                    for (int q = 0; q < Q; ++q) bv[q] = b1[q] + a1[q];
+                }
+                else if (dir > 0) {
+                    for (int q = 0; q < Q; ++q) {
+                        bv[q] = std::max(b0[q], b1[q] + a1[q]);
+                    }
+                }
+                else {
+                    for (int q = 0; q < Q; ++q) {
+                        bv[q] = std::min(b0[q], b1[q] + a1[q]);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<int> witness(int q) const {
+        std::vector<int> items;
+        size_t v = fd.root();
+        while (v >= 2) {
+            int i = fd.level_of(v);
+            uint32_t c1 = fd.child(v, 1);
+            // prefer the 1-edge on ties, as optimize_single does
+            bool take = (c1 != 0 and best[(size_t)c1 * Q + q]
+                         + weight[(size_t)(n - i) * Q + q] == best[v * Q + q]);
+            if (take) items.push_back(n - i);
+            v = fd.child(v, take ? 1 : 0);
+        }
+        return items;
+    }
+
+public:
+    BatchOptimization() {}
+
+    /*****
+     * optimize(costs, direction="maximize", with_witness=false)
+     *      Return (optimal value, one optimal subset) for each cost vector
+     *      in costs; the subsets are left empty unless with_witness = true.
+     *      Subsets are in the same numbering as unfold_ddstructure.
+     *****/
+    std::vector<std::pair<T, std::vector<int>>> optimize(
+        const std::vector<std::vector<int>>& costs,
+        std::string direction = "maximize",
+        bool with_witness = false
+    ) {
+        Q = costs.size();
+        std::vector<std::pair<T, std::vector<int>>> res(Q);
+        if (Q == 0) return res;
+
+        weight.assign((size_t)n * Q, 0);
+        for (int q = 0; q < Q; ++q) {
+            assert((int)costs[q].size() >= n);
+            for (int k = 0; k < n; ++k) weight[(size_t)k * Q + q] = costs[q][k];
+        }
+        compute_best(direction == "maximize" ? 1 : -1);
+
+        for (int q = 0; q < Q; ++q) {
+            res[q].first = best[(size_t)fd.root() * Q + q];
+            if (with_witness) res[q].second = witness(q);
+        }
+        return res;
+    }
 };
 
 } // namespace sapporo_tdzdd_apps
@@ -0,0 +1,220 @@
+#ifndef SAPPORO_TDZDD_APPS_PERSISTENCE_HPP
+#define SAPPORO_TDZDD_APPS_PERSISTENCE_HPP
+
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <istream>
+#include <streambuf>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <tdzdd/DdStructure.hpp>
+#include "flat_diagram.hpp"
+#include "for_tdzdd/graph_data.hpp"
+
+namespace sapporo_tdzdd_apps {
+
+/*****
+ * class MappedFile
+ *      Read-only memory mapping of a whole file (POSIX mmap).
+ *      The mapping is released when the object is destroyed.
+ *****/
+class MappedFile {
+private:
+    const char* ptr;
+    size_t length;
+
+public:
+    explicit MappedFile(const std::string& path) : ptr(nullptr), length(0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open " + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("cannot stat " + path);
+        }
+        length = st.st_size;
+        if (length > 0) {
+            void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("cannot map " + path);
+            }
+            ptr = (const char*)p;
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (ptr != nullptr) munmap((void*)ptr, length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return ptr; }
+    size_t size() const { return length; }
+};
+
+/*****
+ * Diagram file format (version 2, native byte order)
+ *      DiagramFileHeader, then at the recorded byte positions
+ *      (each 8-byte aligned):
+ *          offset   uint64_t[top_level + 2]
+ *          children child_width-byte indices [2 * n_nodes]
+ *          graph    Graph::write_binary output (if graph_size > 0)
+ *      The arrays are those of FlatDiagram, so a loaded diagram points
+ *      straight into the mapping. Only child_width = 4 is written,
+ *      since FlatDiagram is limited to 2^32 nodes; the field is kept
+ *      so that wider indices can be added in a later version.
+ *      Version 2 changed the graph section to the flat Graph layout.
+ *****/
+struct DiagramFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t child_width;
+    uint64_t top_level;
+    uint64_t n_nodes;
+    uint64_t root;
+    uint64_t offset_pos;
+    uint64_t child_pos;
+    uint64_t graph_pos;
+    uint64_t graph_size;
+};
+
+const char DIAGRAM_FILE_MAGIC[8] = {'S', 'T', 'Z', 'D', 'D', 'F', 'L', 'T'};
+const uint32_t DIAGRAM_FILE_VERSION = 2;
+
+/*****
+ * save_diagram(path, fd, G=nullptr)
+ *      Write fd (and the item layout of G, if given) to path.
+ *****/
+void save_diagram(
+    const std::string& path,
+    const FlatDiagram& fd,
+    const Graph* G = nullptr
+) {
+    auto align = [](uint64_t x) { return (x + 7) / 8 * 8; };
+
+    std::string graph_bytes;
+    if (G != nullptr) {
+        std::ostringstream gs;
+        G->write_binary(gs);
+        graph_bytes = gs.str();
+    }
+
+    DiagramFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, DIAGRAM_FILE_MAGIC, 8);
+    h.version = DIAGRAM_FILE_VERSION;
+    h.child_width = sizeof(uint32_t);
+    h.top_level = fd.top_level();
+    h.n_nodes = fd.size();
+    h.root = fd.root();
+    h.offset_pos = align(sizeof(h));
+    h.child_pos = align(h.offset_pos + sizeof(uint64_t) * (h.top_level + 2));
+    h.graph_pos = align(h.child_pos + h.child_width * 2 * h.n_nodes);
+    h.graph_size = graph_bytes.size();
+
+    std::ofstream os(path, std::ios::binary);
+    if (not os) throw std::runtime_error("cannot write " + path);
+    auto pad_to = [&](uint64_t pos) {
+        while ((uint64_t)os.tellp() < pos) os.put(0);
+    };
+    os.write((const char*)&h, sizeof(h));
+    pad_to(h.offset_pos);
+    os.write((const char*)fd.offset_array(), sizeof(uint64_t) * (h.top_level + 2));
+    pad_to(h.child_pos);
+    os.write((const char*)fd.child_array(), h.child_width * 2 * h.n_nodes);
+    pad_to(h.graph_pos);
+    os.write(graph_bytes.data(), graph_bytes.size());
+    if (not os) throw std::runtime_error("cannot write " + path);
+}
+
+void save_diagram(
+    const std::string& path,
+    const tdzdd::DdStructure<2>& dd,
+    const Graph* G = nullptr
+) {
+    save_diagram(path, FlatDiagram(dd), G);
+}
+
+// std::streambuf reading a character range in place
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const char* begin, size_t size) {
+        char* p = const_cast<char*>(begin);
+        setg(p, p, p + size);
+    }
+};
+
+/*****
+ * load_diagram(path, G=nullptr)
+ *      Map a file written by save_diagram and return a FlatDiagram
+ *      viewing it; the node arrays are checked in one pass but not
+ *      copied, and the mapping lives as long as the FlatDiagram or
+ *      its copies. If G is given, the stored Graph (with its setup)
+ *      is read from the mapping into it.
+ *      Throw std::runtime_error if the file is not a valid diagram file.
+ *****/
+FlatDiagram load_diagram(const std::string& path, Graph* G = nullptr) {
+    auto file = std::make_shared<MappedFile>(path);
+    auto fail = [&](const std::string& msg) {
+        throw std::runtime_error(path + ": " + msg);
+    };
+    // whether count elements of elem bytes at pos lie within the file
+    auto fits = [&](uint64_t pos, uint64_t count, uint64_t elem) {
+        return pos <= file->size() and count <= (file->size() - pos) / elem;
+    };
+
+    DiagramFileHeader h;
+    if (file->size() < sizeof(h)) fail("too short");
+    std::memcpy(&h, file->data(), sizeof(h));
+    if (std::memcmp(h.magic, DIAGRAM_FILE_MAGIC, 8) != 0) fail("bad magic");
+    if (h.version != DIAGRAM_FILE_VERSION) fail("unsupported version");
+    if (h.child_width != sizeof(uint32_t)) fail("unsupported child width");
+    if (h.offset_pos % 8 != 0 or h.child_pos % 8 != 0) fail("misaligned");
+    if (h.top_level >= (uint64_t)std::numeric_limits<int>::max()) fail("too many levels");
+    if (h.n_nodes < 2 or h.n_nodes > std::numeric_limits<uint32_t>::max()) {
+        fail("bad node count");
+    }
+    if (not fits(h.offset_pos, h.top_level + 2, sizeof(uint64_t))
+        or not fits(h.child_pos, 2 * h.n_nodes, h.child_width)
+        or not fits(h.graph_pos, h.graph_size, 1)) fail("truncated");
+
+    const uint64_t* offset = (const uint64_t*)(file->data() + h.offset_pos);
+    const uint32_t* children = (const uint32_t*)(file->data() + h.child_pos);
+    if (offset[0] != 0 or offset[1] != 2 or offset[h.top_level + 1] != h.n_nodes) {
+        fail("inconsistent size");
+    }
+    for (uint64_t i = 1; i <= h.top_level; ++i) {
+        if (offset[i] > offset[i + 1]) fail("bad level offsets");
+    }
+    // every child lies below the level of its parent
+    for (uint64_t i = 1; i <= h.top_level; ++i) {
+        for (uint64_t k = 2 * offset[i]; k < 2 * offset[i + 1]; ++k) {
+            if (children[k] >= offset[i]) fail("bad child index");
+        }
+    }
+    if (h.root >= h.n_nodes) fail("bad root");
+
+    if (G != nullptr) {
+        if (h.graph_size == 0) fail("no graph stored");
+        MemoryStreamBuf buf(file->data() + h.graph_pos, h.graph_size);
+        std::istream gs(&buf);
+        if (not G->read_binary(gs)) fail("broken graph");
+    }
+
+    return FlatDiagram(h.top_level, h.root, file, offset, children);
+}
+
+} // namespace sapporo_tdzdd_apps
+
+#endif
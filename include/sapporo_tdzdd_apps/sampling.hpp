@@ -0,0 +1,170 @@
+#ifndef SAPPORO_TDZDD_APPS_SAMPLING_HPP
+#define SAPPORO_TDZDD_APPS_SAMPLING_HPP
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cassert>
+#include <tdzdd/DdStructure.hpp>
+#include "converter.hpp"
+#include "semiring.hpp"
+
+namespace sapporo_tdzdd_apps {
+
+/*****
+ * class SplitMix64
+ *      Small random number generator (UniformRandomBitGenerator).
+ *      Seeding is one store, so a fresh stream per block of samples
+ *      is cheap; see Sampler::sample_many.
+ *****/
+class SplitMix64 {
+private:
+    uint64_t x;
+
+public:
+    typedef uint64_t result_type;
+
+    explicit SplitMix64(uint64_t seed) : x(seed) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    result_type operator()() {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+};
+
+/*****
+ * class Sampler
+ *      Draw subsets from a family uniformly, or with probability
+ *      proportional to the product of the weights of their items.
+ *      The constructor evaluates LogSumProduct once, so families with
+ *      more than 1e308 subsets are fine, and keeps for every node
+ *      the probability of its 1-edge and its item. A draw then walks
+ *      one root-to-terminal path, O(depth), without allocation
+ *      besides the result.
+ *      Subsets are in the same numbering as unfold_ddstructure(n_vars, dd).
+ *
+ *      Sampler sampler(n_vars, dd);
+ *      SplitMix64 rng(seed);
+ *      std::vector<int> X = sampler.sample(rng);
+ *****/
+class Sampler {
+private:
+    int n_vars;
+    FlatDiagram fd;
+    std::vector<double> take_prob;
+    std::vector<int> item;
+
+    void setup(const std::vector<double>& weights) {
+        int n = fd.top_level();
+        assert(n <= n_vars);
+        assert(weights.empty() or (int)weights.size() >= n_vars);
+
+        std::vector<double> logw(n, 0.0);
+        for (int i = 1; i <= n; ++i) {
+            if (not weights.empty()) logw[n - i] = std::log(weights[n_vars - i]);
+        }
+        std::vector<double> val = semiring_values<LogSumProduct>(fd, {}, logw);
+
+        take_prob.assign(fd.size(), 0.0);
+        item.assign(fd.size(), -1);
+        for (int i = 1; i <= n; ++i) {
+            for (size_t v = fd.level_begin(i); v < fd.level_end(i); ++v) {
+                double x1 = val[fd.child(v, 1)] + logw[n - i];
+                take_prob[v] = std::exp(x1 - val[v]);
+                item[v] = n_vars - i;
+            }
+        }
+    }
+
+public:
+    /*****
+     * Sampler(n_vars, dd, weights={})
+     *      weights[k] > 0 is the weight of item k; empty means uniform.
+     *****/
+    Sampler(
+        int n_vars,
+        const tdzdd::DdStructure<2>& dd,
+        const std::vector<double>& weights = {}
+    ) : n_vars(n_vars), fd(dd) {
+        setup(weights);
+    }
+
+    Sampler(
+        int n_vars,
+        const ZBDD& f,
+        const std::vector<double>& weights = {}
+    ) : n_vars(n_vars), fd(to_ddstructure(f)) {
+        setup(weights);
+    }
+
+    Sampler(
+        int n_vars,
+        const FlatDiagram& fd,
+        const std::vector<double>& weights = {}
+    ) : n_vars(n_vars), fd(fd) {
+        setup(weights);
+    }
+
+    bool empty() const {
+        return fd.root() == 0;
+    }
+
+    /*****
+     * sample(rng)
+     *      Return one subset drawn with the rng (any
+     *      UniformRandomBitGenerator). The family must not be empty.
+     *****/
+    template<typename RNG>
+    std::vector<int> sample(RNG& rng) const {
+        assert(not empty());
+        std::vector<int> X;
+        size_t v = fd.root();
+        while (v >= 2) {
+            double u = std::generate_canonical<double, 53>(rng);
+            bool take = (u < take_prob[v]);
+            if (take) X.push_back(item[v]);
+            v = fd.child(v, take ? 1 : 0);
+        }
+        return X;
+    }
+
+    /*****
+     * sample_many(count, seed, use_mp=false)
+     *      Return count subsets. Samples are drawn in blocks of BLOCK,
+     *      each from its own SplitMix64 stream seeded by (seed, block),
+     *      so the result does not depend on the number of threads.
+     *      If use_mp = true, blocks are distributed over OpenMP threads.
+     *****/
+    std::vector<std::vector<int>> sample_many(
+        long long count,
+        uint64_t seed,
+        bool use_mp = false
+    ) const {
+        const long long BLOCK = 1024;
+        std::vector<std::vector<int>> res(count);
+        long long n_blocks = (count + BLOCK - 1) / BLOCK;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (use_mp)
+#else
+        (void)use_mp;
+#endif
+        for (long long k = 0; k < n_blocks; ++k) {
+            SplitMix64 stream_seed(seed ^ (0xd1b54a32d192ed03ULL * (k + 1)));
+            SplitMix64 rng(stream_seed());
+            long long end = std::min(count, (k + 1) * BLOCK);
+            for (long long s = k * BLOCK; s < end; ++s) res[s] = sample(rng);
+        }
+        return res;
+    }
+};
+
+} // namespace sapporo_tdzdd_apps
+
+#endif
@@ -6,6 +6,7 @@
 #include <functional>
 #include <cassert>
 #include <set>
+#include <unordered_map>
 #include "for_sapporo/ext_operations.hpp"
 
 namespace sapporo_tdzdd_apps {
@@ -35,52 +36,76 @@ ZBDD zbdd_single_subset(const std::vector<int>& S) {
 
 /*****
  * zbdd_extraction(zbdd, targets)
- *      TODO: description
+ *      Construct ZBDD obtained by restricting each subset to targets,
+ *      i.e., every item not in targets is removed from each subset.
+ *      Each node is processed only once (memoized by its ZBDD ID),
+ *      so it takes time linear in the number of nodes.
  *****/
 ZBDD zbdd_extraction(const ZBDD& zbdd, const std::set<int>& targets) {
+    std::vector<bool> is_target(zbdd.Top() + 1, false);
+    for (int i : targets) if (i < (int)is_target.size()) is_target[i] = true;
+
+    std::unordered_map<bddword, ZBDD> memo;
     std::function<ZBDD(const ZBDD&)> rec = [&](const ZBDD& f) {
         if (f == 0 or f == 1) return f;
+        auto it = memo.find(f.GetID());
+        if (it != memo.end()) return it->second;
         int i = f.Top();
         ZBDD f0 = f.OffSet(i), f1 = f.OnSet0(i);
         ZBDD g0 = rec(f0), g1 = rec(f1);
-        if (targets.count(i) == 1) g1 = g1.Change(i);
-        return g0 + g1;
+        if (is_target[i]) g1 = g1.Change(i);
+        return memo[f.GetID()] = g0 + g1;
     };
     return rec(zbdd);
 }
 
+/*****
+ * visit_zbdd(n_vars, zbdd, visitor)
+ *      Call visitor(subset) for each subset of a given ZBDD over n_vars
+ *      variables, in the same numbering as unfold_zbdd.
+ *      Subsets are generated on demand into one reused buffer,
+ *      so it needs O(n_vars) working memory besides the ZBDD.
+ *      If visitor returns false, the traversal stops immediately.
+ *      Return false if it was stopped by visitor, otherwise true.
+ *****/
+template<typename Visitor>
+bool visit_zbdd(int n_vars, const ZBDD& zbdd, Visitor visitor) {
+    assert(zbdd.Top() <= n_vars);
+
+    std::vector<int> ans;
+    ans.reserve(n_vars);
+
+    std::function<bool(const ZBDD&)> dfs = [&](const ZBDD& f) {
+        if (f == 0) return true;
+        if (f == 1) return (bool)visitor((const std::vector<int>&)ans);
+        int i = f.Top();
+        if (not dfs(f.OffSet(i))) return false;
+        ans.push_back(n_vars - i);
+        bool cont = dfs(f.OnSet0(i));
+        ans.pop_back();
+        return cont;
+    };
+
+    return dfs(zbdd);
+}
+
 /*****
  * unfold_zbdd(n_vars, zbdd, sorted)
  *      Unfold a given ZBDD over n_vars variables.
  *      Each vector in return value represents a subset.
  *      If sorted = true, subsets are sorted in lexicographical order.
+ *      Use visit_zbdd for large families.
  *****/
 std::vector<std::vector<int>> unfold_zbdd(
     int n_vars,
     const ZBDD& zbdd,
     bool sorted = false
 ) {
-    assert(zbdd.Top() <= n_vars);
-    
     std::vector<std::vector<int>> answer_set;
-    
-    std::function<void(const ZBDD&, std::vector<int>&)> dfs =
-    [&](const ZBDD& f, std::vector<int>& ans) {
-        if (f == 0) return;
-        if (f == 1) {
-            answer_set.push_back(ans);
-            return;
-        }
-        int i = f.Top();
-        ZBDD f0 = f.OffSet(i), f1 = f.OnSet0(i);
-        dfs(f0, ans);
-        ans.push_back(n_vars - i);
-        dfs(f1, ans);
-        ans.pop_back();
-    };
-
-    std::vector<int> tmp;
-    dfs(zbdd, tmp);
+    visit_zbdd(n_vars, zbdd, [&](const std::vector<int>& ans) {
+        answer_set.push_back(ans);
+        return true;
+    });
     if (sorted) std::sort(answer_set.begin(), answer_set.end());
     return answer_set;
 }
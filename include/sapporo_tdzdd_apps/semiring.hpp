@@ -0,0 +1,194 @@
+#ifndef SAPPORO_TDZDD_APPS_SEMIRING_HPP
+#define SAPPORO_TDZDD_APPS_SEMIRING_HPP
+
+#include <vector>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <cassert>
+#include "flat_diagram.hpp"
+
+namespace sapporo_tdzdd_apps {
+
+/*****
+ * Semiring policies for evaluate_semiring.
+ *      Each policy defines Value, zero(), one(), plus(a, b) and times(a, b).
+ *      The 0-terminal evaluates to zero() and the 1-terminal to one().
+ *****/
+
+/*****
+ * SumProduct<T>
+ *      Weighted counting, e.g. the number of subsets (all weights one)
+ *      or reliability (weights p and 1 - p).
+ *****/
+template<typename T> struct SumProduct {
+    typedef T Value;
+    static Value zero() { return 0; }
+    static Value one() { return 1; }
+    static Value plus(Value a, Value b) { return a + b; }
+    static Value times(Value a, Value b) { return a * b; }
+};
+
+/*****
+ * MinPlus<T>
+ *      Minimum total weight; zero() is max() and absorbs times.
+ *****/
+template<typename T> struct MinPlus {
+    typedef T Value;
+    static Value zero() { return std::numeric_limits<T>::max(); }
+    static Value one() { return 0; }
+    static Value plus(Value a, Value b) { return std::min(a, b); }
+    static Value times(Value a, Value b) {
+        return (a == zero() or b == zero() ? zero() : a + b);
+    }
+};
+
+/*****
+ * MaxPlus<T>
+ *      Maximum total weight; zero() is lowest() and absorbs times.
+ *****/
+template<typename T> struct MaxPlus {
+    typedef T Value;
+    static Value zero() { return std::numeric_limits<T>::lowest(); }
+    static Value one() { return 0; }
+    static Value plus(Value a, Value b) { return std::max(a, b); }
+    static Value times(Value a, Value b) {
+        return (a == zero() or b == zero() ? zero() : a + b);
+    }
+};
+
+/*****
+ * MinPlusCount<T, C=unsigned long long>
+ *      Minimum total weight and the number of subsets attaining it.
+ *      Weights are given as (weight, 1).
+ *****/
+template<typename T, typename C = unsigned long long> struct MinPlusCount {
+    typedef std::pair<T, C> Value;
+    static Value zero() { return Value(std::numeric_limits<T>::max(), 0); }
+    static Value one() { return Value(0, 1); }
+    static Value plus(const Value& a, const Value& b) {
+        if (a.first != b.first) return (a.first < b.first ? a : b);
+        return Value(a.first, a.second + b.second);
+    }
+    static Value times(const Value& a, const Value& b) {
+        if (a.second == 0 or b.second == 0) return zero();
+        return Value(a.first + b.first, a.second * b.second);
+    }
+};
+
+/*****
+ * Boolean
+ *      Nonemptiness; with weight 0 on some items, whether a subset
+ *      avoiding them exists.
+ *****/
+struct Boolean {
+    typedef uint8_t Value;
+    static Value zero() { return 0; }
+    static Value one() { return 1; }
+    static Value plus(Value a, Value b) { return a | b; }
+    static Value times(Value a, Value b) { return a & b; }
+};
+
+/*****
+ * LogSumProduct
+ *      SumProduct in log space, for counts and weights beyond double;
+ *      weights are given as logarithms.
+ *****/
+struct LogSumProduct {
+    typedef double Value;
+    static Value zero() { return -std::numeric_limits<double>::infinity(); }
+    static Value one() { return 0; }
+    static Value plus(Value a, Value b) {
+        if (a < b) std::swap(a, b);
+        if (b == zero()) return a;
+        return a + std::log1p(std::exp(b - a));
+    }
+    static Value times(Value a, Value b) { return a + b; }
+};
+
+/*****
+ * semiring_values<S>(fd, w0, w1, use_mp=false)
+ *      Evaluate every node of fd bottom-up as
+ *          value(v) = plus(times(value(lo), w0[k]), times(value(hi), w1[k]))
+ *      where k = top_level() - (level of v) is the item of v, and return
+ *      the values indexed like fd. An empty w0 means one() for all items.
+ *      Otherwise items skipped by an edge (zero-suppressed) contribute
+ *      their w0 too, which costs a level lookup per edge.
+ *      If use_mp = true, each level is split across OpenMP threads.
+ *****/
+template<typename S>
+std::vector<typename S::Value> semiring_values(
+    const FlatDiagram& fd,
+    const std::vector<typename S::Value>& w0,
+    const std::vector<typename S::Value>& w1,
+    bool use_mp = false
+) {
+    typedef typename S::Value Value;
+    int n = fd.top_level();
+    assert((int)w1.size() >= n);
+    assert(w0.empty() or (int)w0.size() >= n);
+
+    std::vector<Value> val(fd.size(), S::zero());
+    val[1] = S::one();
+    const uint32_t* child = fd.child_array();
+
+#ifdef _OPENMP
+    // levels narrower than this are not worth waking threads for
+    const long long MP_MIN_WIDTH = 1024;
+#else
+    (void)use_mp;
+#endif
+    // skip[r] is the product of w0 over the levels from r + 1 to i - 1
+    std::vector<Value> skip;
+    for (int i = 1; i <= n; ++i) {
+        long long begin = fd.level_begin(i), end = fd.level_end(i);
+        const Value a1 = w1[n - i];
+        if (w0.empty()) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (use_mp and end - begin >= MP_MIN_WIDTH)
+#endif
+            for (long long v = begin; v < end; ++v) {
+                val[v] = S::plus(val[child[2 * v]],
+                                 S::times(val[child[2 * v + 1]], a1));
+            }
+            continue;
+        }
+
+        const Value a0 = w0[n - i];
+        skip.assign(i, S::one());
+        for (int r = i - 2; r >= 0; --r) {
+            skip[r] = S::times(skip[r + 1], w0[n - r - 1]);
+        }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (use_mp and end - begin >= MP_MIN_WIDTH)
+#endif
+        for (long long v = begin; v < end; ++v) {
+            uint32_t c0 = child[2 * v], c1 = child[2 * v + 1];
+            Value x0 = S::times(val[c0], S::times(skip[fd.level_of(c0)], a0));
+            Value x1 = S::times(val[c1], S::times(skip[fd.level_of(c1)], a1));
+            val[v] = S::plus(x0, x1);
+        }
+    }
+    return val;
+}
+
+/*****
+ * evaluate_semiring<S>(fd, w0, w1, use_mp=false)
+ *      Return the value of the root; see semiring_values.
+ *****/
+template<typename S>
+typename S::Value evaluate_semiring(
+    const FlatDiagram& fd,
+    const std::vector<typename S::Value>& w0,
+    const std::vector<typename S::Value>& w1,
+    bool use_mp = false
+) {
+    return semiring_values<S>(fd, w0, w1, use_mp)[fd.root()];
+}
+
+} // namespace sapporo_tdzdd_apps
+
+#endif
@@ -1,17 +1,73 @@
 #ifndef SAPPORO_TDZDD_APPS_TDZDD_FUNCS_HPP
 #define SAPPORO_TDZDD_APPS_TDZDD_FUNCS_HPP
 
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <chrono>
 #include <tdzdd/DdSpecOp.hpp>
 #include <tdzdd/DdStructure.hpp>
+#include <tdzdd/dd/NodeTable.hpp>
 #include "for_tdzdd/graph_data.hpp"
+#include "for_tdzdd/slot_type.hpp"
 #include "for_tdzdd/component_spec.hpp"
 #include "for_tdzdd/degree_spec.hpp"
+#include "for_tdzdd/path_spec.hpp"
 #include "for_tdzdd/linear_spec.hpp"
+#include "for_tdzdd/build_stats.hpp"
 
 namespace sapporo_tdzdd_apps {
 
 /*****
- * tdzdd_linear_inequalities(A, sign, b)
+ * build_reduced_dd(spec, use_mp=false, stats=nullptr, G=nullptr)
+ *      Construct DdStructure from a given spec and reduce it as a ZDD.
+ *      If use_mp = true, both construction and reduction run on
+ *      the OpenMP versions of TdZdd (compile with -fopenmp);
+ *      the number of threads follows OMP_NUM_THREADS.
+ *      If stats is given, it is overwritten with the statistics
+ *      of this build (see BuildStats), including the frontier sizes
+ *      of G if G is given.
+ *      Every tdzdd_* function below passes its use_mp and stats to this.
+ *****/
+template<typename SPEC>
+tdzdd::DdStructure<2> build_reduced_dd(
+    const SPEC& spec,
+    bool use_mp = false,
+    BuildStats* stats = nullptr,
+    const Graph* G = nullptr
+) {
+    if (stats == nullptr) {
+        tdzdd::DdStructure<2> dd(spec, use_mp);
+        dd.useMultiProcessors(use_mp);
+        dd.zddReduce();
+        return dd;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    auto sec = [](Clock::time_point a, Clock::time_point b) {
+        return std::chrono::duration<double>(b - a).count();
+    };
+    auto t0 = Clock::now();
+    tdzdd::DdStructure<2> dd(spec, use_mp);
+    auto t1 = Clock::now();
+    BuildStats::record_widths(dd, stats->unreduced_width);
+    dd.useMultiProcessors(use_mp);
+    dd.zddReduce();
+    auto t2 = Clock::now();
+    BuildStats::record_widths(dd, stats->reduced_width);
+
+    stats->state_bytes = spec.datasize();
+    stats->construction_sec = sec(t0, t1);
+    stats->reduction_sec = sec(t1, t2);
+    stats->est_peak_table_bytes = sizeof(tdzdd::Node<2>)
+        * (stats->unreduced_nodes() + stats->reduced_nodes());
+    if (G != nullptr) stats->record_frontier(*G);
+    else stats->frontier_size.clear();
+    return dd;
+}
+
+/*****
+ * tdzdd_linear_inequalities(A, sign, b, use_mp=false, stats=nullptr)
  *      Construct DdStructure representing all the 0-1 valid assignments
  *      each of which satisfies all the given linear inequalities (Ax sign b).
  *      Inequality sings can be different for each row.
@@ -19,114 +75,149 @@ namespace sapporo_tdzdd_apps {
 tdzdd::DdStructure<2> tdzdd_linear_inequalities(
     const std::vector<std::vector<int>>& A,
     const std::vector<std::string>& sign,
-    const std::vector<int>& b
+    const std::vector<int>& b,
+    bool use_mp = false,
+    BuildStats* stats = nullptr
 ) {
     LinearIneqSpec spec(A, sign, b);
-    tdzdd::DdStructure<2> dd(spec);
-    dd.zddReduce();
-    return dd;
+    return build_reduced_dd(spec, use_mp, stats);
 }
 
 /*****
- * tdzdd_st_path(G, s, t, with_vertex=false)
+ * tdzdd_linear_inequalities(A, sign, b, use_mp=false, stats=nullptr)
+ *      Same as above for a sparse A given as CsrMatrix.
+ *      Memory and time per item depend on the number of nonzeros.
+ *****/
+tdzdd::DdStructure<2> tdzdd_linear_inequalities(
+    const CsrMatrix& A,
+    const std::vector<std::string>& sign,
+    const std::vector<int>& b,
+    bool use_mp = false,
+    BuildStats* stats = nullptr
+) {
+    SparseLinearIneqSpec spec(A, sign, b);
+    return build_reduced_dd(spec, use_mp, stats);
+}
+
+/*****
+ * tdzdd_st_path(G, s, t, with_vertex=false, use_mp=false, stats=nullptr)
  *      Construct DdStructure representing all the s-t paths in G.
+ *      If s == t, it represents all the paths with s as one end
+ *      (built by intersecting ConnectedSpec and RangeDegreeSpec,
+ *      since PathSpec needs two distinct ends).
  *****/
 tdzdd::DdStructure<2> tdzdd_st_paths(
     const Graph& G,
     int s,
     int t,
-    bool with_vertex = false
+    bool with_vertex = false,
+    bool use_mp = false,
+    BuildStats* stats = nullptr
 ) {
     int n = G.max_vertex_number() + 1;
     assert(0 <= s and s < n and 0 <= t and t < n);
-    std::vector<int> lb(n, 0), ub(n, 2);
-    lb[s] = lb[t] = ub[s] = ub[t] = 1;
-    ConnectedSpec cc(G, true, with_vertex);
-    RangeDegreeSpec deg(G, lb, ub, with_vertex);
-    tdzdd::ZddIntersection<decltype(cc), decltype(deg)> spec(cc, deg);
-    tdzdd::DdStructure<2> dd(spec);
-    dd.zddReduce();
-    return dd;
+    if (s == t) {
+        std::vector<int> lb(n, 0), ub(n, 2);
+        lb[s] = ub[s] = 1;
+        int F = G.max_frontier_size();
+        return with_slot_type(std::max(F, 2 * (2 + 2)), [&](auto slot) {
+            typedef decltype(slot) Slot;
+            ConnectedSpec<Slot> cc(G, true, with_vertex);
+            RangeDegreeSpec<Slot> deg(G, lb, ub, with_vertex);
+            tdzdd::ZddIntersection<decltype(cc), decltype(deg)> spec(cc, deg);
+            return build_reduced_dd(spec, use_mp, stats, &G);
+        });
+    }
+    return with_slot_type(G.max_frontier_size() + 4, [&](auto slot) {
+        PathSpec<decltype(slot)> spec(G, s, t, with_vertex);
+        return build_reduced_dd(spec, use_mp, stats, &G);
+    });
 }
 
 /*****
- * tdzdd_cycles(G, with_vertex=false)
+ * tdzdd_cycles(G, with_vertex=false, use_mp=false, stats=nullptr)
  *      Construct DdStructure representing all the cycles in G.
  *****/
 tdzdd::DdStructure<2> tdzdd_cycles(
     const Graph& G,
-    bool with_vertex = false
+    bool with_vertex = false,
+    bool use_mp = false,
+    BuildStats* stats = nullptr
 ) {
-    int n = G.max_vertex_number() + 1;
-    std::vector<std::set<int>> candidates(n, {0, 2});
-    ConnectedSpec cc(G, false, with_vertex);
-    DegreeSpec deg(G, candidates, with_vertex);
-    tdzdd::ZddIntersection<decltype(cc), decltype(deg)> spec(cc, deg);
-    tdzdd::DdStructure<2> dd(spec);
-    dd.zddReduce();
-    return dd;
+    return with_slot_type(G.max_frontier_size() + 4, [&](auto slot) {
+        CycleSpec<decltype(slot)> spec(G, with_vertex);
+        return build_reduced_dd(spec, use_mp, stats, &G);
+    });
 }
 
 /*****
- * tdzdd_trees(G, with_vertex=false)
+ * tdzdd_trees(G, with_vertex=false, use_mp=false, stats=nullptr)
  *      Construct DdStructure representing all the connected components in G.
  *****/
 tdzdd::DdStructure<2> tdzdd_connected_components(
     const Graph& G, 
-    bool with_vertex = false
+    bool with_vertex = false,
+    bool use_mp = false,
+    BuildStats* stats = nullptr
 ) {
-    ConnectedSpec spec(G, false, with_vertex);
-    tdzdd::DdStructure<2> dd(spec);
-    dd.zddReduce();
-    return dd;    
+    return with_slot_type(G.max_frontier_size(), [&](auto slot) {
+        ConnectedSpec<decltype(slot)> spec(G, false, with_vertex);
+        return build_reduced_dd(spec, use_mp, stats, &G);
+    });
 }
 
 /*****
- * tdzdd_trees(G, with_vertex=false)
+ * tdzdd_trees(G, with_vertex=false, use_mp=false, stats=nullptr)
  *      Construct DdStructure representing all the trees in G.
  *****/
 tdzdd::DdStructure<2> tdzdd_trees(
     const Graph& G,
-    bool with_vertex = false
+    bool with_vertex = false,
+    bool use_mp = false,
+    BuildStats* stats = nullptr
 ) {
-    ConnectedSpec spec(G, true, with_vertex);
-    tdzdd::DdStructure<2> dd(spec);
-    dd.zddReduce();
-    return dd;
+    return with_slot_type(G.max_frontier_size(), [&](auto slot) {
+        ConnectedSpec<decltype(slot)> spec(G, true, with_vertex);
+        return build_reduced_dd(spec, use_mp, stats, &G);
+    });
 }
 
 /*****
- * tdzdd_trees(G, T, with_vertex=false)
+ * tdzdd_trees(G, T, with_vertex=false, use_mp=false, stats=nullptr)
  *      Construct DdStructure representing all the steiner trees of T in G.
  *****/
 tdzdd::DdStructure<2> tdzdd_steiner_trees(
     const Graph& G,
     const std::set<int>& T,
-    bool with_vertex = false
+    bool with_vertex = false,
+    bool use_mp = false,
+    BuildStats* stats = nullptr
 ) {
-    SteinerSpec stnr(G, T, with_vertex);
-    ConnectedSpec tree(G, true, with_vertex);
-    tdzdd::ZddIntersection<decltype(stnr), decltype(tree)> spec(stnr, tree);
-    tdzdd::DdStructure<2> dd(spec);
-    dd.zddReduce();
-    return dd;
+    return with_slot_type(G.max_frontier_size(), [&](auto slot) {
+        SteinerSpec stnr(G, T, with_vertex);
+        ConnectedSpec<decltype(slot)> tree(G, true, with_vertex);
+        tdzdd::ZddIntersection<decltype(stnr), decltype(tree)> spec(stnr, tree);
+        return build_reduced_dd(spec, use_mp, stats, &G);
+    });
 }
 
 /*****
- * tdzdd_trees(G, with_vertex=false)
+ * tdzdd_trees(G, with_vertex=false, use_mp=false, stats=nullptr)
  *      Construct DdStructure representing all the spanning trees in G.
  *****/
 tdzdd::DdStructure<2> tdzdd_spanning_trees(
     const Graph& G,
-    bool with_vertex = false
+    bool with_vertex = false,
+    bool use_mp = false,
+    BuildStats* stats = nullptr
 ) {
     std::set<int> T;
     for (int v : G.vertices()) T.insert(v);
-    return tdzdd_steiner_trees(G, T, with_vertex);
+    return tdzdd_steiner_trees(G, T, with_vertex, use_mp, stats);
 }
 
 /*****
- * tdzdd_degree_constraints(G, lb, ub, with_vertex=false)
+ * tdzdd_degree_constraints(G, lb, ub, with_vertex=false, use_mp=false, stats=nullptr)
  *      Construct DdStructure representing all the valid subgraphs of G
  *      each of which satisfies a given degree constraint
  *      lb_v <= deg_v <= ub_v for each vertex.
@@ -135,28 +226,68 @@ tdzdd::DdStructure<2> tdzdd_degree_constraints(
     const Graph& G,
     const std::vector<int>& lb,
     const std::vector<int>& ub,
-    bool with_vertex = false
+    bool with_vertex = false,
+    bool use_mp = false,
+    BuildStats* stats = nullptr
 ) {
-    RangeDegreeSpec spec(G, lb, ub, with_vertex);
-    tdzdd::DdStructure<2> dd(spec);
-    dd.zddReduce();
-    return dd;
+    // a degree never exceeds the number of edges
+    int max_ub = (ub.empty() ? 0 : *std::max_element(ub.begin(), ub.end()));
+    int max_deg = std::min(max_ub, G.n_edges());
+    return with_slot_type(2 * (max_deg + 2), [&](auto slot) {
+        RangeDegreeSpec<decltype(slot)> spec(G, lb, ub, with_vertex);
+        return build_reduced_dd(spec, use_mp, stats, &G);
+    });
 }
 
 /*****
- * tdzdd_steiner(G, T, with_vertex=false)
+ * tdzdd_steiner(G, T, with_vertex=false, use_mp=false, stats=nullptr)
  *      Construct DdStructure representing all the valid subgraphs of G
  *      each of which has all the vertices in T.
  *****/
 tdzdd::DdStructure<2> tdzdd_steiner(
     const Graph& G,
     const std::set<int> T,
-    bool with_vertex = false
+    bool with_vertex = false,
+    bool use_mp = false,
+    BuildStats* stats = nullptr
 ) {
     SteinerSpec spec(G, T, with_vertex);
-    tdzdd::DdStructure<2> dd(spec);
-    dd.zddReduce();
-    return dd;
+    return build_reduced_dd(spec, use_mp, stats, &G);
+}
+
+/*****
+ * visit_ddstructure(n_vars, dd, visitor)
+ *      Call visitor(subset) for each subset of a given DdStructure over
+ *      n_vars variables, in the same numbering as unfold_ddstructure.
+ *      Subsets are generated on demand into one reused buffer,
+ *      so it needs O(n_vars) working memory besides the DdStructure.
+ *      If visitor returns false, the traversal stops immediately.
+ *      Return false if it was stopped by visitor, otherwise true.
+ *****/
+template<typename Visitor>
+bool visit_ddstructure(
+    int n_vars,
+    const tdzdd::DdStructure<2>& dd,
+    Visitor visitor
+) {
+    const tdzdd::NodeTableEntity<2>& diagram = *dd.getDiagram();
+
+    std::vector<int> ans;
+    ans.reserve(n_vars);
+
+    std::function<bool(tdzdd::NodeId)> dfs = [&](tdzdd::NodeId f) {
+        if (f.row() == 0) {
+            if (f.col() == 0) return true;
+            return (bool)visitor((const std::vector<int>&)ans);
+        }
+        if (not dfs(diagram.child(f, 0))) return false;
+        ans.push_back(n_vars - f.row());
+        bool cont = dfs(diagram.child(f, 1));
+        ans.pop_back();
+        return cont;
+    };
+
+    return dfs(dd.root());
 }
 
 /*****
@@ -164,6 +295,7 @@ tdzdd::DdStructure<2> tdzdd_steiner(
  *      Unfold a given DdStructure over n_vars variables.
  *      Each vector in return value represents a subset.
  *      If sorted = true, subsets are sorted in lexicographical order.
+ *      Use visit_ddstructure for large families.
  *****/
 std::vector<std::vector<int>> unfold_ddstructure(
     int n_vars,
@@ -171,15 +303,10 @@ std::vector<std::vector<int>> unfold_ddstructure(
     bool sorted = false
 ) {
     std::vector<std::vector<int>> answer_set;
-    for (auto path = dd.begin(); path != dd.end(); ++path) {
-        std::vector<int> ans;
-        for (auto it = path->begin(); it != path->end(); ++it) {
-            int i = n_vars - *it;
-            ans.push_back(i);
-        }
-        std::reverse(ans.begin(), ans.end());
+    visit_ddstructure(n_vars, dd, [&](const std::vector<int>& ans) {
         answer_set.push_back(ans);
-    }
+        return true;
+    });
     if (sorted) std::sort(answer_set.begin(), answer_set.end());
     return answer_set;
 }
@@ -0,0 +1,536 @@
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cassert>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+using namespace std;
+
+#include "sapporo_tdzdd_apps/all_apps.hpp"
+#include "graph_generator.hpp"
+#include "instance_reader.hpp"
+#include "legacy_impl.hpp"
+using namespace sapporo_tdzdd_apps;
+using namespace tdzdd;
+
+/***** sub functions *****/
+template<typename F> double measure_sec(F func) {
+    auto start = chrono::steady_clock::now();
+    func();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double>(end - start).count();
+}
+
+// peak resident set size (VmHWM) in kB, or -1 if unavailable
+long peak_rss_kb() {
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return stol(line.substr(6));
+    }
+    return -1;
+}
+
+// reset VmHWM to the current RSS (Linux 4.0 or later)
+void reset_peak_rss() {
+    ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5" << endl;
+}
+
+/***** benchmarks *****/
+void bench_extraction(int max_n) {
+    // the legacy version visits every path of the ZBDD,
+    // so it is skipped for families larger than this
+    const bddword LEGACY_MAX_CARD = 10000000;
+
+    cout << "n,zbdd_nodes,legacy_sec,memo_sec" << endl;
+    for (int n = 2; n <= max_n; ++n) {
+        Graph G = make_grid_graph(n);
+        DdStructure<2> dd = tdzdd_spanning_trees(G, true);
+        check_sapporo_vars(G.n_items());
+        ZBDD f = to_zbdd(dd);
+
+        set<int> targets;
+        for (int v : G.vertices()) targets.insert(G.sapporo_var_of_vertex(v));
+
+        ZBDD g_memo;
+        double t_memo = measure_sec([&] {
+            g_memo = zbdd_extraction(f, targets);
+        });
+
+        cout << n << "," << dd.size() << ",";
+        if (f.Card() <= LEGACY_MAX_CARD) {
+            ZBDD g_legacy;
+            double t_legacy = measure_sec([&] {
+                g_legacy = legacy_zbdd_extraction(f, targets);
+            });
+            assert(g_legacy == g_memo);
+            cout << t_legacy;
+        }
+        else cout << "NA";
+        cout << "," << t_memo << endl;
+    }
+}
+
+void bench_scaling(int n) {
+    int max_threads = 1;
+#ifdef _OPENMP
+    max_threads = omp_get_max_threads();
+#endif
+    Graph G = make_grid_graph(n);
+
+    cout << "n,threads,nodes,sec" << endl;
+    for (int threads = 1; threads <= max_threads; ++threads) {
+#ifdef _OPENMP
+        omp_set_num_threads(threads);
+#endif
+        DdStructure<2> dd;
+        double t = measure_sec([&] {
+            dd = tdzdd_connected_components(G, false, threads > 1);
+        });
+        cout << n << "," << threads << "," << dd.size() << "," << t << endl;
+    }
+}
+
+void bench_component(int max_n) {
+    cout << "kind,n,nodes,legacy_sec,new_sec" << endl;
+    for (int n = 2; n <= max_n; ++n) {
+        Graph G = make_grid_graph(n);
+        for (string kind : {"trees", "cycles"}) {
+            DdStructure<2> dd_legacy, dd_new;
+            double t_legacy = measure_sec([&] {
+                if (kind == "trees") dd_legacy = legacy_tdzdd_trees(G);
+                else dd_legacy = legacy_tdzdd_cycles(G);
+            });
+            double t_new = measure_sec([&] {
+                if (kind == "trees") dd_new = tdzdd_trees(G);
+                else dd_new = tdzdd_cycles(G);
+            });
+            assert(dd_legacy.zddCardinality() == dd_new.zddCardinality());
+            cout << kind << "," << n << "," << dd_new.size() << ","
+                 << t_legacy << "," << t_new << endl;
+        }
+    }
+}
+
+void bench_dp_scaling(int n) {
+    int max_threads = 1;
+#ifdef _OPENMP
+    max_threads = omp_get_max_threads();
+#endif
+    Graph G = make_grid_graph(n);
+    DdStructure<2> dd = tdzdd_cycles(G);
+    vector<int> cost(G.n_items());
+    for (int i = 0; i < G.n_items(); ++i) cost[i] = (i * 7919) % 100 - 50;
+
+    cout << "n,threads,nodes,value,sec" << endl;
+    for (int threads = 1; threads <= max_threads; ++threads) {
+#ifdef _OPENMP
+        omp_set_num_threads(threads);
+#endif
+        LinearOptimization<long long> opt;
+        opt.set_dd(dd);
+        opt.set_use_mp(threads > 1);
+        pair<long long, vector<int>> res;
+        double t = measure_sec([&] {
+            res = opt.optimize_single(cost);
+        });
+        cout << n << "," << threads << "," << dd.size() << ","
+             << res.first << "," << t << endl;
+    }
+}
+
+void bench_semiring(int max_n) {
+    cout << "n,nodes,legacy_sec,optimize_sec,single_sec,count_sec" << endl;
+    for (int n = 2; n <= max_n; ++n) {
+        Graph G = make_grid_graph(n);
+        DdStructure<2> dd = tdzdd_cycles(G);
+        check_sapporo_vars(dd.topLevel());
+        vector<int> cost(dd.topLevel());
+        for (int i = 0; i < (int)cost.size(); ++i) cost[i] = (i * 7919) % 100;
+
+        pair<long long, ZBDD> res_legacy, res_new;
+        double t_legacy = measure_sec([&] {
+            res_legacy = legacy_bottom_up_dp<long long>(dd, cost, 1);
+        });
+        LinearOptimization<long long> opt;
+        opt.set_dd(dd);
+        double t_new = measure_sec([&] {
+            res_new = opt.optimize(cost);
+        });
+        assert(res_legacy == res_new);
+        double t_single = measure_sec([&] {
+            opt.optimize_single(cost);
+        });
+
+        FlatDiagram fd(dd);
+        vector<double> ones(fd.top_level(), 1.0);
+        double count = 0;
+        double t_count = measure_sec([&] {
+            count = evaluate_semiring<SumProduct<double>>(fd, {}, ones);
+        });
+        assert(to_string((unsigned long long)count) == dd.zddCardinality());
+
+        cout << n << "," << dd.size() << "," << t_legacy << "," << t_new
+             << "," << t_single << "," << t_count << endl;
+    }
+}
+
+void bench_batch(int n) {
+    Graph G = make_grid_graph(n);
+    DdStructure<2> dd = tdzdd_cycles(G);
+    int m = dd.topLevel();
+
+    cout << "n,nodes,queries,single_sec,batch_sec" << endl;
+    for (int Q : {1, 4, 16, 64, 256}) {
+        vector<vector<int>> costs(Q, vector<int>(m));
+        for (int q = 0; q < Q; ++q) {
+            for (int i = 0; i < m; ++i) costs[q][i] = (i * 7919 + q * 104729) % 100;
+        }
+        LinearOptimization<long long> opt;
+        opt.set_dd(dd);
+        vector<long long> single(Q);
+        double t_single = measure_sec([&] {
+            for (int q = 0; q < Q; ++q) single[q] = opt.optimize_single(costs[q]).first;
+        });
+        BatchOptimization<long long> batch;
+        batch.set_dd(dd);
+        vector<pair<long long, vector<int>>> res;
+        double t_batch = measure_sec([&] {
+            res = batch.optimize(costs);
+        });
+        for (int q = 0; q < Q; ++q) assert(res[q].first == single[q]);
+        cout << n << "," << dd.size() << "," << Q << ","
+             << t_single << "," << t_batch << endl;
+    }
+}
+
+// time per solution of RankedOptimization::next, which should grow
+// with the number of levels (the length of a path) but not with nodes
+void bench_ranked(int max_n) {
+    const int k = 10000;
+    cout << "n,levels,nodes,solutions,prepare_sec,usec_per_solution" << endl;
+    for (int n = 3; n <= max_n; ++n) {
+        Graph G = make_grid_graph(n);
+        DdStructure<2> dd = tdzdd_cycles(G);
+        vector<int> cost(G.n_items());
+        for (int i = 0; i < G.n_items(); ++i) cost[i] = (i * 7919) % 100 - 50;
+
+        RankedOptimization<long long> ranked;
+        ranked.set_dd(dd);
+        double t_prepare = measure_sec([&] {
+            ranked.prepare(cost, "minimize");
+        });
+        int count = 0;
+        pair<long long, vector<int>> sol;
+        double t_next = measure_sec([&] {
+            while (count < k and ranked.next(sol)) ++count;
+        });
+        cout << n << "," << dd.topLevel() << "," << dd.size() << ","
+             << count << "," << t_prepare << ","
+             << 1e6 * t_next / max(count, 1) << endl;
+    }
+}
+
+void bench_sampling(int n) {
+    int max_threads = 1;
+#ifdef _OPENMP
+    max_threads = omp_get_max_threads();
+#endif
+    Graph G = make_grid_graph(n);
+    DdStructure<2> dd = tdzdd_spanning_trees(G);
+    const long long count = 1000000;
+
+    Sampler sampler(G.n_items(), dd);
+    cout << "n,nodes,threads,samples,sec" << endl;
+    for (int threads = 1; threads <= max_threads; ++threads) {
+#ifdef _OPENMP
+        omp_set_num_threads(threads);
+#endif
+        double t = measure_sec([&] {
+            sampler.sample_many(count, 1, threads > 1);
+        });
+        cout << n << "," << dd.size() << "," << threads << ","
+             << count << "," << t << endl;
+    }
+}
+
+void bench_conversion(int max_n) {
+    cout << "n,nodes,legacy_to_zbdd_sec,to_zbdd_sec,"
+         << "legacy_to_dd_sec,to_dd_sec" << endl;
+    for (int n = 2; n <= max_n; ++n) {
+        Graph G = make_grid_graph(n);
+        DdStructure<2> dd = tdzdd_spanning_trees(G, true);
+        check_sapporo_vars(dd.topLevel());
+
+        ZBDD f_legacy, f_new;
+        double t_zbdd_legacy = measure_sec([&] { f_legacy = legacy_to_zbdd(dd); });
+        double t_zbdd_new = measure_sec([&] { f_new = to_zbdd(dd); });
+        assert(f_legacy == f_new);
+
+        DdStructure<2> dd_legacy, dd_new;
+        double t_dd_legacy = measure_sec([&] {
+            dd_legacy = legacy_to_ddstructure(f_new);
+        });
+        double t_dd_new = measure_sec([&] { dd_new = to_ddstructure(f_new); });
+        assert(dd_legacy.size() == dd_new.size());
+        assert(to_zbdd(dd_new) == f_new);
+
+        cout << n << "," << dd.size() << "," << t_zbdd_legacy << ","
+             << t_zbdd_new << "," << t_dd_legacy << "," << t_dd_new << endl;
+    }
+}
+
+void bench_graph_setup(int max_n) {
+    cout << "side,edges,add_edge_sec,setup_sec,write_sec,read_sec" << endl;
+    for (int n = 1; n <= max_n; ++n) {
+        int side = 100 * n;
+        Graph H = make_grid_graph(side);
+        vector<pair<int, int>> edges;
+        for (int i = 0; i < H.n_edges(); ++i) {
+            int k = H.var_of_edge(i);
+            edges.push_back(make_pair(H.item_v0(k), H.item_v1(k)));
+        }
+
+        Graph G;
+        double t_add = measure_sec([&] {
+            for (auto& e : edges) G.add_edge(e.first, e.second);
+        });
+        double t_setup = measure_sec([&] { G.setup(); });
+        stringstream ss;
+        double t_write = measure_sec([&] { G.write_binary(ss); });
+        Graph R;
+        double t_read = measure_sec([&] { R.read_binary(ss); });
+        assert(R.n_items() == G.n_items());
+
+        cout << side << "," << G.n_edges() << "," << t_add << ","
+             << t_setup << "," << t_write << "," << t_read << endl;
+    }
+}
+
+void bench_loader(int max_n) {
+    cout << "side,edges,read_graph_sec,load_text_sec,load_binary_sec" << endl;
+    const string text_path = "bench_graph.txt", bin_path = "bench_graph.bin";
+    for (int n = 1; n <= max_n; ++n) {
+        int side = 100 * n;
+        Graph G = make_grid_graph(side);
+        {
+            ofstream os(text_path);
+            os << G.max_vertex_number() + 1 << " " << G.n_edges() << "\n";
+            for (int i = 0; i < G.n_edges(); ++i) {
+                os << G.edge(i).first << " " << G.edge(i).second << "\n";
+            }
+        }
+        save_graph_binary(bin_path, G);
+
+        Graph R, T, B;
+        double t_stream = measure_sec([&] {
+            ifstream is(text_path);
+            R = read_graph(is);
+        });
+        double t_text = measure_sec([&] { T = load_graph(text_path); });
+        double t_bin = measure_sec([&] { B = load_graph(bin_path); });
+        assert(R.n_items() == T.n_items() and T.n_items() == B.n_items());
+
+        cout << side << "," << G.n_edges() << "," << t_stream << ","
+             << t_text << "," << t_bin << endl;
+    }
+    remove(text_path.c_str());
+    remove(bin_path.c_str());
+}
+
+void bench_simpath(int max_n) {
+    cout << "kind,n,legacy_unreduced,legacy_sec,unreduced,sec,reduced" << endl;
+    for (string kind : {"st_paths", "cycles"}) {
+        for (int n = 2; n <= max_n; ++n) {
+            Graph G = make_grid_graph(n);
+            BuildStats legacy_stats, stats;
+            DdStructure<2> dd_legacy, dd_new;
+            double t_legacy = measure_sec([&] {
+                if (kind == "st_paths") {
+                    dd_legacy = legacy_intersection_st_paths(G, 0, n*n-1, false, &legacy_stats);
+                }
+                else dd_legacy = legacy_intersection_cycles(G, false, &legacy_stats);
+            });
+            double t_new = measure_sec([&] {
+                if (kind == "st_paths") dd_new = tdzdd_st_paths(G, 0, n*n-1, false, false, &stats);
+                else dd_new = tdzdd_cycles(G, false, false, &stats);
+            });
+            assert(dd_legacy.size() == dd_new.size());
+            assert(dd_legacy.zddCardinality() == dd_new.zddCardinality());
+
+            cout << kind << "," << n << "," << legacy_stats.unreduced_nodes() << ","
+                 << t_legacy << "," << stats.unreduced_nodes() << "," << t_new << ","
+                 << dd_new.size() << endl;
+        }
+    }
+}
+
+/***** benchmark suite *****/
+// print one CSV row per run of func, which returns the reduced DD
+// (or nullptr if the workload does not produce one) and fills stats
+// if it builds one
+template<typename F>
+void suite_run(
+    const string& family, int size, const string& workload,
+    int max_frontier, F func
+) {
+    reset_peak_rss();
+    BuildStats stats;
+    const DdStructure<2>* dd = nullptr;
+    double t = measure_sec([&] { dd = func(&stats); });
+    cout << family << "," << size << "," << workload << "," << t << ","
+         << peak_rss_kb() << ",";
+    if (not stats.unreduced_width.empty()) cout << stats.unreduced_nodes();
+    else cout << "NA";
+    cout << ",";
+    if (dd != nullptr) cout << dd->size();
+    else cout << "NA";
+    cout << ",";
+    if (max_frontier >= 0) cout << max_frontier;
+    else cout << "NA";
+    cout << endl;
+}
+
+void suite_graph(const string& family, int size, const Graph& G) {
+    // unfolding is skipped for families larger than this
+    const double UNFOLD_MAX_CARD = 100000;
+
+    int F = G.max_frontier_size();
+    int n = G.max_vertex_number() + 1;
+    int s = *G.vertices().begin(), t = G.max_vertex_number();
+    set<int> T = {s, t};
+    vector<int> lb(n, 0), ub(n, 2);
+    DdStructure<2> dd, tree, tree_v;
+
+    suite_run(family, size, "st_paths", F, [&](BuildStats* stats) {
+        dd = tdzdd_st_paths(G, s, t, false, false, stats); return &dd;
+    });
+    suite_run(family, size, "cycles", F, [&](BuildStats* stats) {
+        dd = tdzdd_cycles(G, false, false, stats); return &dd;
+    });
+    suite_run(family, size, "connected_components", F, [&](BuildStats* stats) {
+        dd = tdzdd_connected_components(G, false, false, stats); return &dd;
+    });
+    suite_run(family, size, "trees", F, [&](BuildStats* stats) {
+        dd = tdzdd_trees(G, false, false, stats); return &dd;
+    });
+    suite_run(family, size, "steiner_trees", F, [&](BuildStats* stats) {
+        dd = tdzdd_steiner_trees(G, T, false, false, stats); return &dd;
+    });
+    suite_run(family, size, "degree_constraints", F, [&](BuildStats* stats) {
+        dd = tdzdd_degree_constraints(G, lb, ub, false, false, stats); return &dd;
+    });
+    suite_run(family, size, "steiner", F, [&](BuildStats* stats) {
+        dd = tdzdd_steiner(G, T, false, false, stats); return &dd;
+    });
+    suite_run(family, size, "spanning_trees", F, [&](BuildStats* stats) {
+        tree = tdzdd_spanning_trees(G, false, false, stats); return &tree;
+    });
+    suite_run(family, size, "spanning_trees_with_vertex", F, [&](BuildStats* stats) {
+        tree_v = tdzdd_spanning_trees(G, true, false, stats); return &tree_v;
+    });
+
+    int m = G.n_items();
+    check_sapporo_vars(m);
+    ZBDD f, f_v;
+    suite_run(family, size, "to_zbdd", -1, [&](BuildStats* stats) {
+        f = to_zbdd(tree); f_v = to_zbdd(tree_v); return nullptr;
+    });
+    suite_run(family, size, "to_ddstructure", -1, [&](BuildStats* stats) {
+        dd = to_ddstructure(f); return &dd;
+    });
+    suite_run(family, size, "zbdd_extraction", -1, [&](BuildStats* stats) {
+        set<int> targets;
+        for (int v : G.vertices()) targets.insert(G.sapporo_var_of_vertex(v));
+        zbdd_extraction(f_v, targets);
+        return nullptr;
+    });
+    suite_run(family, size, "linear_optimization", -1, [&](BuildStats* stats) {
+        vector<int> cost(m);
+        for (int i = 0; i < m; ++i) cost[i] = (i * 7919) % 100;
+        LinearOptimization<long long> opt;
+        opt.set_dd(tree);
+        opt.optimize(cost);
+        return nullptr;
+    });
+    if (stod(tree.zddCardinality()) <= UNFOLD_MAX_CARD) {
+        suite_run(family, size, "unfold_ddstructure", -1, [&](BuildStats* stats) {
+            unfold_ddstructure(m, tree); return nullptr;
+        });
+        suite_run(family, size, "unfold_zbdd", -1, [&](BuildStats* stats) {
+            unfold_zbdd(m, f); return nullptr;
+        });
+    }
+}
+
+void suite_inequalities(int n_vars, int n_rows, double density, int seed) {
+    mt19937 rng(seed);
+    uniform_int_distribution<int> coef(1, 20);
+    bernoulli_distribution nonzero(density);
+    vector<vector<int>> A(n_rows, vector<int>(n_vars, 0));
+    vector<string> sign(n_rows, "<=");
+    vector<int> b(n_rows, 0);
+    for (int r = 0; r < n_rows; ++r) {
+        for (int i = 0; i < n_vars; ++i) {
+            if (nonzero(rng)) A[r][i] = coef(rng);
+            b[r] += A[r][i];
+        }
+        b[r] /= 2;
+    }
+    string family = (density < 1.0 ? "sparse_inequalities" : "inequalities");
+    DdStructure<2> dd;
+    suite_run(family, n_vars, "dense_input", -1, [&](BuildStats* stats) {
+        dd = tdzdd_linear_inequalities(A, sign, b, false, stats); return &dd;
+    });
+    CsrMatrix M = make_csr_matrix(A);
+    suite_run(family, n_vars, "sparse_input", -1, [&](BuildStats* stats) {
+        dd = tdzdd_linear_inequalities(M, sign, b, false, stats); return &dd;
+    });
+}
+
+// grids, complete graphs and random sparse graphs of size 2..max_n and
+// random inequality systems of up to 32 variables, all with fixed seeds;
+// "make run-bench" writes the CSV to bench.csv.
+void bench_suite(int max_n) {
+    cout << "family,size,workload,sec,peak_rss_kb,"
+         << "unreduced_nodes,reduced_nodes,max_frontier" << endl;
+    for (int n = 2; n <= max_n; ++n) suite_graph("grid", n, make_grid_graph(n));
+    for (int n = 3; n <= max_n; ++n) suite_graph("complete", n, make_complete_graph(n));
+    for (int n = 2; n <= max_n; ++n) {
+        Graph G = make_random_graph(4 * n, 6 * n, n);
+        G.setup(G.beam_search_edge_order().first);
+        suite_graph("random_sparse", n, G);
+    }
+    // inequalities stop at 32 variables: at 40, the sparse family with
+    // 10 rows needs more than 6 GB during construction
+    for (int n = 2; n <= std::min(max_n, 8); ++n) {
+        suite_inequalities(4 * n, 3, 1.0, n);
+        suite_inequalities(4 * n, n, 0.3, n);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    SapporoMemoryManager::instance().init(100000000, 10000);
+    string bench_type(argv[1]);
+    int max_n = (argc > 2 ? stoi(argv[2]) : 6);
+
+    if (bench_type == "-extract") bench_extraction(max_n);
+    if (bench_type == "-scaling") bench_scaling(max_n);
+    if (bench_type == "-component") bench_component(max_n);
+    if (bench_type == "-dp") bench_dp_scaling(max_n);
+    if (bench_type == "-semiring") bench_semiring(max_n);
+    if (bench_type == "-batch") bench_batch(max_n);
+    if (bench_type == "-ranked") bench_ranked(max_n);
+    if (bench_type == "-sample") bench_sampling(max_n);
+    if (bench_type == "-convert") bench_conversion(max_n);
+    if (bench_type == "-suite") bench_suite(max_n);
+    if (bench_type == "-graph") bench_graph_setup(max_n);
+    if (bench_type == "-load") bench_loader(max_n);
+    if (bench_type == "-simpath") bench_simpath(max_n);
+}
@@ -0,0 +1,72 @@
+#ifndef SAPPORO_TDZDD_APPS_GRAPH_GENERATOR_HPP
+#define SAPPORO_TDZDD_APPS_GRAPH_GENERATOR_HPP
+
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include "sapporo_tdzdd_apps/for_tdzdd/graph_data.hpp"
+
+sapporo_tdzdd_apps::Graph make_complete_graph(int n) {
+    sapporo_tdzdd_apps::Graph G;
+    for (int u = 0; u < n; ++u) {
+        for (int v = u + 1; v < n; ++v) {
+            G.add_edge(u, v);
+        }
+    }
+    G.setup();
+    return G;
+}
+
+sapporo_tdzdd_apps::Graph make_grid_graph(int n) {
+    auto to_v = [&](int y, int x) { return y * n + x; };
+    sapporo_tdzdd_apps::Graph G;
+    for (int y = 0; y < n; ++y) for (int x = 0; x < n; ++x) {
+        if (x < n - 1) G.add_edge(to_v(y, x), to_v(y, x + 1));
+        if (y < n - 1) G.add_edge(to_v(y, x), to_v(y + 1, x));
+    }
+    G.setup();
+    return G;
+}
+
+sapporo_tdzdd_apps::Graph make_random_graph(int n, int m, int seed) {
+    // a random spanning tree plus random extra edges, without multi-edges
+    std::mt19937 rng(seed);
+    std::set<std::pair<int, int>> edges;
+    for (int v = 1; v < n; ++v) {
+        int u = std::uniform_int_distribution<int>(0, v - 1)(rng);
+        edges.insert(std::make_pair(u, v));
+    }
+    m = std::min((long long)m, (long long)n * (n - 1) / 2);
+    std::uniform_int_distribution<int> vertex(0, n - 1);
+    while ((int)edges.size() < m) {
+        int u = vertex(rng), v = vertex(rng);
+        if (u == v) continue;
+        edges.insert(std::make_pair(std::min(u, v), std::max(u, v)));
+    }
+    sapporo_tdzdd_apps::Graph G;
+    for (auto& e : edges) G.add_edge(e.first, e.second);
+    G.setup();
+    return G;
+}
+
+sapporo_tdzdd_apps::Graph make_random_multigraph(int n, int m, std::mt19937& rng) {
+    // a random spanning tree plus random extra edges (possibly parallel),
+    // set up with a random edge order
+    std::uniform_int_distribution<int> vertex(0, n - 1);
+    sapporo_tdzdd_apps::Graph G;
+    for (int v = 1; v < n; ++v) G.add_edge(vertex(rng) % v, v);
+    while (G.n_edges() < m) {
+        int u = vertex(rng), v = vertex(rng);
+        if (u != v) G.add_edge(std::min(u, v), std::max(u, v));
+    }
+    std::vector<int> order(G.n_edges());
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+    G.setup(order);
+    return G;
+}
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef SAPPORO_TDZDD_APPS_LEGACY_IMPL_HPP
+#define SAPPORO_TDZDD_APPS_LEGACY_IMPL_HPP
+
+/*****
+ * Previous implementations kept as baselines for bench.cpp.
+ *****/
+
+#include <set>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <tdzdd/spec/SapporoZdd.hpp>
+#include <tdzdd/eval/ToZBDD.hpp>
+#include "sapporo_tdzdd_apps/all_apps.hpp"
+
+ZBDD legacy_zbdd_extraction(const ZBDD& zbdd, const std::set<int>& targets) {
+    std::function<ZBDD(const ZBDD&)> rec = [&](const ZBDD& f) {
+        if (f == 0 or f == 1) return f;
+        int i = f.Top();
+        ZBDD f0 = f.OffSet(i), f1 = f.OnSet0(i);
+        ZBDD g0 = rec(f0), g1 = rec(f1);
+        if (targets.count(i) == 1) g1 = g1.Change(i);
+        return g0 + g1;
+    };
+    return rec(zbdd);
+}
+
+class LegacyComponentSpecBase {
+protected:
+    const sapporo_tdzdd_apps::Graph& G;
+    const int F;
+    const bool non_cyclic;
+    const bool with_vertex;
+    
+    const int INIT = -1;
+
+    int entry(int* mate, int v) const {
+        int i = G.frontier_index(v);
+        if (mate[i] == INIT) mate[i] = *std::max_element(mate, mate + F) + 1;
+        return i;
+    }
+
+    void translation(int* mate) const {
+        int c = 0;
+        std::vector<int> trans(F + 1, -1);
+        for (int i = 0; i < F; ++i) {
+            int mi = mate[i];
+            if (mi == INIT) continue;
+            if (trans[mi] == -1) trans[mi] = mate[i] = c++;
+            else mate[i] = trans[mi];
+        }
+    }
+
+    void connect(int* mate, int ui, int vi) const {
+        int a = mate[ui], b = mate[vi];
+        for (int i = 0; i < F; ++i) if (mate[i] == a) mate[i] = b;
+        translation(mate);
+    }
+
+    bool is_independent(int* mate, int i) const {
+        if (mate[i] == INIT) return false;
+        for (int j = 0; j < F; ++j) {
+            if (j == i) continue;
+            if (mate[i] == mate[j]) return false;
+        }
+        return true;
+    }
+
+    bool find_other_component(int* mate, int c) const {
+        for (int i = 0; i < F; ++i) {
+            if (mate[i] == INIT) continue;
+            if (mate[i] != c) return true; 
+        }
+        return false;
+    }
+
+public:
+    LegacyComponentSpecBase(
+        const sapporo_tdzdd_apps::Graph& G,
+        bool non_cyclic,
+        bool with_vertex
+    ) : G(G), F(G.max_frontier_size()),
+        non_cyclic(non_cyclic), with_vertex(with_vertex) {}
+};
+
+class LegacyConnectedSpec :
+    public tdzdd::PodArrayDdSpec<LegacyConnectedSpec, int, 2>,
+    public LegacyComponentSpecBase {
+public:
+    LegacyConnectedSpec(
+        const sapporo_tdzdd_apps::Graph& G,
+        bool non_cyclic = false,
+        bool with_vertex = false
+    ) : LegacyComponentSpecBase(G, non_cyclic, with_vertex)
+    {
+        setArraySize(F);
+    }
+
+    int getRoot(int* mate) const {
+        for (int i = 0; i < F; ++i) mate[i] = INIT;
+        return G.n_items();
+    }
+
+    int getChild(int* mate, int level, bool take) const {
+        int i = G.n_items() - level;
+
+        if (G.is_vertex(i)) {
+            if (take and not with_vertex) return 0;
+            // the vertex of item i leaves frontier
+            int vi = G.frontier_index(G.item_v0(i));
+            if (with_vertex) {
+                if (not take and mate[vi] != INIT) return 0;
+                if (take and mate[vi] == INIT) return 0;
+            }
+            // check component
+            if (is_independent(mate, vi)) {
+                if (find_other_component(mate, mate[vi])) return 0;
+                return -1; // complete
+            }
+            mate[vi] = INIT;
+        }
+        else if (take) {
+            int u = G.item_v0(i), v = G.item_v1(i);
+            int ui = entry(mate, u), vi = entry(mate, v);
+            if (non_cyclic and mate[ui] == mate[vi]) return 0; // cyclic
+            connect(mate, ui, vi);
+        }
+
+        return level - 1;
+    }
+};
+
+tdzdd::DdStructure<2> legacy_tdzdd_trees(const sapporo_tdzdd_apps::Graph& G) {
+    LegacyConnectedSpec spec(G, true);
+    tdzdd::DdStructure<2> dd(spec);
+    dd.zddReduce();
+    return dd;
+}
+
+tdzdd::DdStructure<2> legacy_tdzdd_cycles(const sapporo_tdzdd_apps::Graph& G) {
+    int n = G.max_vertex_number() + 1;
+    std::vector<std::set<int>> candidates(n, {0, 2});
+    LegacyConnectedSpec cc(G, false);
+    sapporo_tdzdd_apps::DegreeSpec deg(G, candidates);
+    tdzdd::ZddIntersection<decltype(cc), decltype(deg)> spec(cc, deg);
+    tdzdd::DdStructure<2> dd(spec);
+    dd.zddReduce();
+    return dd;
+}
+
+// s-t paths and cycles as intersections of ConnectedSpec with a degree spec
+tdzdd::DdStructure<2> legacy_intersection_st_paths(
+    const sapporo_tdzdd_apps::Graph& G,
+    int s,
+    int t,
+    bool with_vertex = false,
+    sapporo_tdzdd_apps::BuildStats* stats = nullptr
+) {
+    using namespace sapporo_tdzdd_apps;
+    int n = G.max_vertex_number() + 1;
+    std::vector<int> lb(n, 0), ub(n, 2);
+    lb[s] = lb[t] = ub[s] = ub[t] = 1;
+    int F = G.max_frontier_size();
+    return with_slot_type(std::max(F, 2 * (2 + 2)), [&](auto slot) {
+        typedef decltype(slot) Slot;
+        ConnectedSpec<Slot> cc(G, true, with_vertex);
+        RangeDegreeSpec<Slot> deg(G, lb, ub, with_vertex);
+        tdzdd::ZddIntersection<decltype(cc), decltype(deg)> spec(cc, deg);
+        return build_reduced_dd(spec, false, stats, &G);
+    });
+}
+
+tdzdd::DdStructure<2> legacy_intersection_cycles(
+    const sapporo_tdzdd_apps::Graph& G,
+    bool with_vertex = false,
+    sapporo_tdzdd_apps::BuildStats* stats = nullptr
+) {
+    using namespace sapporo_tdzdd_apps;
+    int n = G.max_vertex_number() + 1;
+    std::vector<std::set<int>> candidates(n, {0, 2});
+    int F = G.max_frontier_size();
+    return with_slot_type(std::max(F, 2 + 1), [&](auto slot) {
+        typedef decltype(slot) Slot;
+        ConnectedSpec<Slot> cc(G, false, with_vertex);
+        DegreeSpec<Slot> deg(G, candidates, with_vertex);
+        tdzdd::ZddIntersection<decltype(cc), decltype(deg)> spec(cc, deg);
+        return build_reduced_dd(spec, false, stats, &G);
+    });
+}
+
+template<typename T>
+std::pair<T, ZBDD> legacy_bottom_up_dp(
+    const tdzdd::DdStructure<2>& dd,
+    const std::vector<int>& cost,
+    int dir
+) {
+    auto func = [&](T a, T b) {
+        if (dir > 0) return std::max(a, b);
+        else return std::min(a, b);
+    };
+
+    int n = dd.topLevel();
+    const tdzdd::NodeTableHandler<2>& diagram = dd.getDiagram();
+    std::vector<std::vector<T>> best(n + 1, std::vector<T>());
+    std::vector<std::vector<ZBDD>> ans(n + 1, std::vector<ZBDD>());
+    for (int i = 0; i <= n; ++i) {
+        int w = (*diagram)[i].size();
+        if (dir > 0) best[i].assign(w, std::numeric_limits<T>().min());
+        if (dir < 0) best[i].assign(w, std::numeric_limits<T>().max());
+        ans[i].assign(w, ZBDD(0));
+    }
+    best[0][1] = 0;
+    ans[0][1] = ZBDD(1);
+
+    for (int i = 1; i <= n; ++i) {
+        int w = (*diagram)[i].size();
+        for (int j = 0; j < w; ++j) {
+            for (int b = 0; b < 2; ++b) {
+                tdzdd::NodeId node = diagram->child(i, j, b);
+                int r = node.row(), c = node.col();
+                if (r == 0 and c == 0) continue;
+                T val = best[r][c] + (b == 1 ? cost[n - i] : 0);
+                best[i][j] = func(best[i][j], val);
+            }
+            for (int b = 0; b < 2; ++b) {
+                tdzdd::NodeId node = diagram->child(i, j, b);
+                int r = node.row(), c = node.col();
+                if (r == 0 and c == 0) continue;
+                T val = best[r][c] + (b == 1 ? cost[n - i] : 0);
+                if (best[i][j] > val) continue;
+                ans[i][j] += (b == 0 ? ans[r][c] : ans[r][c].Change(i));
+            }
+        }
+    }
+
+    return std::pair<T, ZBDD>(best[n][0], ans[n][0]);
+}
+
+tdzdd::DdStructure<2> legacy_to_ddstructure(const ZBDD& zbdd) {
+    return tdzdd::DdStructure<2>(tdzdd::SapporoZdd(zbdd));
+}
+
+ZBDD legacy_to_zbdd(const tdzdd::DdStructure<2>& dd) {
+    return dd.evaluate(tdzdd::ToZBDD());
+}
+
+#endif
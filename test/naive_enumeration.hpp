@@ -2,6 +2,8 @@
 #define SAPPORO_TDZDD_APPS_NAIVE_ENUMERATION_HPP
 
 #include <algorithm>
+#include <numeric>
+#include <functional>
 #include "instance_reader.hpp"
 
 std::vector<std::vector<int>> naive_linear_inequarities(
@@ -31,4 +33,112 @@ std::vector<std::vector<int>> naive_linear_inequarities(
     return answer_set;
 }
 
+// edge subsets X of G (after setup) with the given degree of every vertex
+// in {deg(v) : v} accepted by degree_ok, which are connected and nonempty,
+// as item numbers (with the touched vertices if with_vertex)
+std::vector<std::vector<int>> naive_connected_subgraphs(
+    const sapporo_tdzdd_apps::Graph& G,
+    std::function<bool(int, int)> degree_ok,
+    bool acyclic,
+    bool with_vertex
+) {
+    int n = G.max_vertex_number() + 1, m = G.n_edges();
+    std::vector<std::vector<int>> answer_set;
+    for (int X = 1; X < (1 << m); ++X) {
+        std::vector<int> deg(n, 0), parent(n);
+        std::iota(parent.begin(), parent.end(), 0);
+        std::function<int(int)> find = [&](int v) {
+            return parent[v] == v ? v : parent[v] = find(parent[v]);
+        };
+        int n_edges = 0;
+        for (int e = 0; e < m; ++e) {
+            if ((X >> e & 1) == 0) continue;
+            std::pair<int, int> uv = G.edge(e);
+            ++deg[uv.first];
+            ++deg[uv.second];
+            parent[find(uv.first)] = find(uv.second);
+            ++n_edges;
+        }
+        bool ok = true;
+        int n_touched = 0, root = -1;
+        for (int v : G.vertices()) {
+            ok &= degree_ok(v, deg[v]);
+            if (deg[v] == 0) continue;
+            ++n_touched;
+            if (root == -1) root = find(v);
+            ok &= (find(v) == root);
+        }
+        if (acyclic) ok &= (n_edges == n_touched - 1);
+        if (not ok) continue;
+
+        std::vector<int> ans;
+        for (int e = 0; e < m; ++e) {
+            if (X >> e & 1) ans.push_back(G.var_of_edge(e));
+        }
+        for (int v : G.vertices()) {
+            if (with_vertex and deg[v] > 0) ans.push_back(G.var_of_vertex(v));
+        }
+        std::sort(ans.begin(), ans.end());
+        answer_set.push_back(ans);
+    }
+    std::sort(answer_set.begin(), answer_set.end());
+    return answer_set;
+}
+
+// edge subsets X of G (after setup) with every degree accepted by
+// degree_ok, as item numbers (with the touched vertices if with_vertex)
+std::vector<std::vector<int>> naive_degree_subgraphs(
+    const sapporo_tdzdd_apps::Graph& G,
+    std::function<bool(int, int)> degree_ok,
+    bool with_vertex
+) {
+    int n = G.max_vertex_number() + 1, m = G.n_edges();
+    std::vector<std::vector<int>> answer_set;
+    for (int X = 0; X < (1 << m); ++X) {
+        std::vector<int> deg(n, 0);
+        for (int e = 0; e < m; ++e) {
+            if ((X >> e & 1) == 0) continue;
+            ++deg[G.edge(e).first];
+            ++deg[G.edge(e).second];
+        }
+        bool ok = true;
+        for (int v : G.vertices()) ok &= degree_ok(v, deg[v]);
+        if (not ok) continue;
+
+        std::vector<int> ans;
+        for (int e = 0; e < m; ++e) {
+            if (X >> e & 1) ans.push_back(G.var_of_edge(e));
+        }
+        for (int v : G.vertices()) {
+            if (with_vertex and deg[v] > 0) ans.push_back(G.var_of_vertex(v));
+        }
+        std::sort(ans.begin(), ans.end());
+        answer_set.push_back(ans);
+    }
+    std::sort(answer_set.begin(), answer_set.end());
+    return answer_set;
+}
+
+std::vector<std::vector<int>> naive_st_paths(
+    const sapporo_tdzdd_apps::Graph& G,
+    int s,
+    int t,
+    bool with_vertex
+) {
+    // for s == t, the paths with s as one end
+    auto degree_ok = [&](int v, int d) {
+        if (v == s or v == t) return d == 1;
+        return (s == t ? d <= 2 : d == 0 or d == 2);
+    };
+    return naive_connected_subgraphs(G, degree_ok, true, with_vertex);
+}
+
+std::vector<std::vector<int>> naive_cycles(
+    const sapporo_tdzdd_apps::Graph& G,
+    bool with_vertex
+) {
+    auto degree_ok = [](int, int d) { return d == 0 or d == 2; };
+    return naive_connected_subgraphs(G, degree_ok, false, with_vertex);
+}
+
 #endif
\ No newline at end of file
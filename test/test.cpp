@@ -1,11 +1,25 @@
 #include <iostream>
 #include <string>
+#include <fstream>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <map>
+#include <set>
+#include <functional>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
 #include <cassert>
 using namespace std;
 
 #include "sapporo_tdzdd_apps/all_apps.hpp"
 #include "instance_reader.hpp"
 #include "naive_enumeration.hpp"
+#include "graph_generator.hpp"
 using namespace sapporo_tdzdd_apps;
 using namespace tdzdd;
 
@@ -15,28 +29,6 @@ void dump_array(const vector<int>& v, std::ostream& os) {
     for (int i = 0; i < n; ++i) os << v[i] << (i < n - 1 ? " " : "\n");
 }
 
-Graph make_complete_graph(int n) {
-    Graph G;
-    for (int u = 0; u < n; ++u) {
-        for (int v = u + 1; v < n; ++v) {
-            G.add_edge(u, v);
-        }
-    }
-    G.setup();
-    return G;
-}
-
-Graph make_grid_graph(int n) {
-    auto to_v = [&](int y, int x) { return y * n + x; };
-    Graph G;
-    for (int y = 0; y < n; ++y) for (int x = 0; x < n; ++x) {
-        if (x < n - 1) G.add_edge(to_v(y, x), to_v(y, x + 1));
-        if (y < n - 1) G.add_edge(to_v(y, x), to_v(y + 1, x));
-    }
-    G.setup();
-    return G;
-}
-
 /***** tests *****/
 void test_powerset() {
     cout << "Test power set" << endl;
@@ -144,6 +136,153 @@ void test_cycle_enumeration() {
     }    
 }
 
+void test_streaming() {
+    cout << "Test streaming unfold" << endl;
+    for (int n = 2; n <= 4; ++n) {
+        cout << "n = " << n << endl;
+        Graph G = make_grid_graph(n);
+        DdStructure<2> dd = tdzdd_st_paths(G, 0, n*n-1);
+        int n_vars = G.n_items();
+        check_sapporo_vars(n_vars);
+        ZBDD f = to_zbdd(dd);
+
+        vector<vector<int>> ans_tdzdd, ans_zbdd;
+        visit_ddstructure(n_vars, dd, [&](const vector<int>& ans) {
+            ans_tdzdd.push_back(ans);
+            return true;
+        });
+        visit_zbdd(n_vars, f, [&](const vector<int>& ans) {
+            ans_zbdd.push_back(ans);
+            return true;
+        });
+        sort(ans_tdzdd.begin(), ans_tdzdd.end());
+        sort(ans_zbdd.begin(), ans_zbdd.end());
+        assert(ans_tdzdd == unfold_ddstructure(n_vars, dd, true));
+        assert(ans_tdzdd == ans_zbdd);
+
+        // stop after the first k solutions
+        const int k = 3;
+        int count_tdzdd = 0, count_zbdd = 0;
+        bool done_tdzdd = visit_ddstructure(n_vars, dd,
+            [&](const vector<int>&) { return ++count_tdzdd < k; });
+        bool done_zbdd = visit_zbdd(n_vars, f,
+            [&](const vector<int>&) { return ++count_zbdd < k; });
+        cout << ans_tdzdd.size() << " "
+             << count_tdzdd << " " << done_tdzdd << " "
+             << count_zbdd << " " << done_zbdd << endl;
+    }
+}
+
+void test_edge_ordering() {
+    cout << "Test edge ordering" << endl;
+    for (int n = 3; n <= 8; ++n) {
+        cout << "n = " << n << endl;
+        // grid graph with shuffled edges
+        Graph H = make_grid_graph(n);
+        vector<int> order = H.edge_order();
+        mt19937 rng(n);
+        shuffle(order.begin(), order.end(), rng);
+        Graph G;
+        for (int i : order) {
+            G.add_edge(H.item_v0(H.var_of_edge(i)), H.item_v1(H.var_of_edge(i)));
+        }
+        G.setup();
+        int f0 = G.max_frontier_size();
+
+        auto res = G.beam_search_edge_order(8);
+        cout << f0 << " -> " << res.second << endl;
+        if (n > 4) continue;
+
+        DdStructure<2> dd0 = tdzdd_spanning_trees(G);
+        DdStructure<2> dd1 = tdzdd_st_paths(G, 0, n*n-1);
+        G.setup(res.first);
+        assert(G.max_frontier_size() == res.second);
+        assert(G.edge_order() == res.first);
+        DdStructure<2> dd2 = tdzdd_spanning_trees(G);
+        DdStructure<2> dd3 = tdzdd_st_paths(G, 0, n*n-1);
+        assert(dd0.zddCardinality() == dd2.zddCardinality());
+        assert(dd1.zddCardinality() == dd3.zddCardinality());
+        cout << dd2.zddCardinality() << " " << dd3.zddCardinality() << endl;
+    }
+}
+
+LinearInequalities make_random_inequalities(
+    int n_vars, int n_rows, int seed, double density = 1.0
+) {
+    mt19937 rng(seed);
+    uniform_int_distribution<int> coef(-5, 5), sgn(0, 2);
+    bernoulli_distribution nonzero(density);
+    LinearInequalities instance(n_vars, n_rows);
+    for (int r = 0; r < n_rows; ++r) {
+        for (int i = 0; i < n_vars; ++i) {
+            instance.A[r][i] =
+                (density < 1.0 and !nonzero(rng) ? 0 : coef(rng));
+        }
+        instance.sign[r] = vector<string>{"<=", "=", ">="}[sgn(rng)];
+        instance.b[r] = coef(rng);
+    }
+    return instance;
+}
+
+void test_linear_inequalities() {
+    cout << "Test linear inequalities" << endl;
+    for (int seed = 0; seed < 20; ++seed) {
+        LinearInequalities instance =
+            make_random_inequalities(10, 1 + seed % 4, seed);
+        DdStructure<2> dd = tdzdd_linear_inequalities(
+            instance.A, instance.sign, instance.b
+        );
+        vector<vector<int>> ans = unfold_ddstructure(instance.n_vars, dd, true);
+        assert(ans == naive_linear_inequarities(instance));
+
+        DdStructure<2> sp = tdzdd_linear_inequalities(
+            make_csr_matrix(instance.A), instance.sign, instance.b
+        );
+        assert(unfold_ddstructure(instance.n_vars, sp, true) == ans);
+        cout << ans.size() << (seed < 19 ? " " : "\n");
+    }
+    for (int seed = 0; seed < 10; ++seed) {
+        LinearInequalities instance =
+            make_random_inequalities(16, 4, seed, 0.3);
+        DdStructure<2> dd = tdzdd_linear_inequalities(
+            make_csr_matrix(instance.A), instance.sign, instance.b
+        );
+        vector<vector<int>> ans = unfold_ddstructure(instance.n_vars, dd, true);
+        assert(ans == naive_linear_inequarities(instance));
+        cout << ans.size() << (seed < 9 ? " " : "\n");
+    }
+
+    // CSR input with columns out of order and split into repeated entries
+    for (int seed = 0; seed < 10; ++seed) {
+        LinearInequalities instance =
+            make_random_inequalities(12, 3, seed, 0.5);
+        mt19937 rng(seed);
+        CsrMatrix M;
+        M.n_rows = instance.A.size();
+        M.n_cols = instance.n_vars;
+        M.row_ptr.push_back(0);
+        for (int r = 0; r < M.n_rows; ++r) {
+            vector<pair<int, int>> row;
+            for (int i = 0; i < M.n_cols; ++i) {
+                int a = instance.A[r][i];
+                if (a == 0) continue;
+                int part = uniform_int_distribution<int>(-3, 3)(rng);
+                row.emplace_back(i, part);
+                row.emplace_back(i, a - part);
+            }
+            shuffle(row.begin(), row.end(), rng);
+            for (auto& e : row) {
+                M.col_index.push_back(e.first);
+                M.value.push_back(e.second);
+            }
+            M.row_ptr.push_back(M.col_index.size());
+        }
+        DdStructure<2> dd = tdzdd_linear_inequalities(M, instance.sign, instance.b);
+        assert(unfold_ddstructure(instance.n_vars, dd, true)
+               == naive_linear_inequarities(instance));
+    }
+}
+
 void test_linear_optimization() {
     vector<vector<int>> A = {{1, 2, 1, 2, 1, 2, 1}};
     vector<string> sign = {"<="};
@@ -156,12 +295,539 @@ void test_linear_optimization() {
     cout << res.first << endl;
     vector<vector<int>> ans = unfold_zbdd(7, res.second);
     for (vector<int> X : ans) dump_array(X, cout);
+
+    // one optimal solution, in both directions
+    for (string dir : {"maximize", "minimize"}) {
+        auto single = opt.optimize_single(cost, dir);
+        auto all = opt.optimize(cost, dir);
+        assert(single.first == all.first);
+        vector<vector<int>> opt_sets = unfold_zbdd(7, all.second, true);
+        assert(count(opt_sets.begin(), opt_sets.end(), single.second) == 1);
+    }
+}
+
+void test_ranked_enumeration() {
+    cout << "Test ranked enumeration" << endl;
+    for (int seed = 0; seed < 10; ++seed) {
+        LinearInequalities instance = make_random_inequalities(10, 2, seed);
+        for (int r = 0; r < 2; ++r) instance.sign[r] = "<=";
+        DdStructure<2> dd = tdzdd_linear_inequalities(
+            instance.A, instance.sign, instance.b
+        );
+        vector<int> cost(instance.n_vars);
+        mt19937 rng(seed);
+        for (int& c : cost) c = uniform_int_distribution<int>(-9, 9)(rng);
+
+        // all the values in nondecreasing order
+        vector<vector<int>> sols = unfold_ddstructure(instance.n_vars, dd);
+        vector<int> values;
+        for (const vector<int>& X : sols) {
+            int v = 0;
+            for (int i : X) v += cost[i];
+            values.push_back(v);
+        }
+        sort(values.begin(), values.end());
+
+        RankedOptimization<int> ranked;
+        ranked.set_dd(dd);
+        ranked.prepare(cost, "minimize");
+        pair<int, vector<int>> sol;
+        vector<vector<int>> seen;
+        while (ranked.next(sol)) {
+            int v = 0;
+            for (int i : sol.second) v += cost[i];
+            assert(v == sol.first);
+            assert(v == values[seen.size()]);
+            seen.push_back(sol.second);
+        }
+        sort(seen.begin(), seen.end());
+        sort(sols.begin(), sols.end());
+        assert(seen == sols);
+
+        auto top = ranked.top_k(cost, 3, "maximize");
+        for (auto& p : top) cout << p.first << " ";
+        cout << "(" << sols.size() << ")" << endl;
+    }
+}
+
+void test_semiring() {
+    cout << "Test semiring" << endl;
+    Graph G = make_grid_graph(3);
+    DdStructure<2> dd = tdzdd_spanning_trees(G);
+    FlatDiagram fd(dd);
+    int m = fd.top_level();
+    vector<vector<int>> sols = unfold_ddstructure(m, dd);
+
+    vector<double> ones(m, 1.0);
+    double count = evaluate_semiring<SumProduct<double>>(fd, {}, ones);
+    assert(count == sols.size());
+
+    // probability that the taken edges form a spanning tree
+    vector<double> p(m, 0.5), q(m, 0.5);
+    double prob = evaluate_semiring<SumProduct<double>>(fd, q, p);
+    assert(prob == sols.size() / pow(2.0, m));
+
+    // minimum weight and the number of minimum spanning trees
+    vector<pair<int, unsigned long long>> w(m);
+    for (int i = 0; i < m; ++i) w[i] = make_pair(i % 3, 1ULL);
+    auto mc = evaluate_semiring<MinPlusCount<int>>(fd, {}, w);
+    map<int, int> hist;
+    for (const vector<int>& X : sols) {
+        int c = 0;
+        for (int i : X) c += i % 3;
+        ++hist[c];
+    }
+    assert(mc.first == hist.begin()->first);
+    assert((int)mc.second == hist.begin()->second);
+
+    // a spanning tree avoiding item 0 exists
+    vector<uint8_t> allowed(m, 1);
+    allowed[0] = 0;
+    assert(evaluate_semiring<Boolean>(fd, {}, allowed) == 1);
+
+    cout << count << " " << prob << " "
+         << mc.first << " " << mc.second << endl;
+}
+
+void test_batch_optimization() {
+    cout << "Test batch optimization" << endl;
+    Graph G = make_grid_graph(3);
+    DdStructure<2> dd = tdzdd_st_paths(G, 0, 8);
+    int m = dd.topLevel();
+    mt19937 rng(0);
+    vector<vector<int>> costs(10, vector<int>(m));
+    for (auto& c : costs) {
+        for (int& x : c) x = uniform_int_distribution<int>(-9, 9)(rng);
+    }
+
+    BatchOptimization<int> batch;
+    batch.set_dd(dd);
+    LinearOptimization<int> opt;
+    opt.set_dd(dd);
+    for (string dir : {"maximize", "minimize"}) {
+        auto res = batch.optimize(costs, dir, true);
+        for (int q = 0; q < (int)costs.size(); ++q) {
+            assert(res[q] == opt.optimize_single(costs[q], dir));
+            cout << res[q].first << " ";
+        }
+        cout << endl;
+    }
+}
+
+void test_sampling() {
+    cout << "Test sampling" << endl;
+    Graph G = make_grid_graph(3);
+    DdStructure<2> dd = tdzdd_spanning_trees(G);
+    int m = G.n_items();
+    vector<vector<int>> sols = unfold_ddstructure(m, dd, true);
+
+    // uniform: every spanning tree about 200 times
+    Sampler sampler(m, dd);
+    long long count = 200 * sols.size();
+    vector<vector<int>> samples = sampler.sample_many(count, 1);
+    assert(samples == sampler.sample_many(count, 1, true));
+    map<vector<int>, int> hist;
+    for (const vector<int>& X : samples) ++hist[X];
+    assert(hist.size() == sols.size());
+    int lo = count, hi = 0;
+    for (auto& p : hist) {
+        assert(binary_search(sols.begin(), sols.end(), p.first));
+        lo = min(lo, p.second);
+        hi = max(hi, p.second);
+    }
+    assert(100 < lo and hi < 300);
+
+    // weighted: item 0 has weight 3 in the power set of 3 items
+    ZBDD f = zbdd_power_set(3);
+    Sampler weighted(3, f, {3.0, 1.0, 1.0});
+    SplitMix64 rng(7);
+    int with0 = 0;
+    for (int s = 0; s < 10000; ++s) {
+        vector<int> X = weighted.sample(rng);
+        if (not X.empty() and X[0] == 0) ++with0;
+    }
+    assert(7000 < with0 and with0 < 8000);
+    cout << lo << " " << hi << " " << with0 << endl;
+}
+
+void test_persistence() {
+    cout << "Test persistence" << endl;
+    Graph G = make_grid_graph(3);
+    G.setup(G.beam_search_edge_order().first);
+    DdStructure<2> dd = tdzdd_spanning_trees(G, true);
+    const string path = "test_persistence.bin";
+    save_diagram(path, dd, &G);
+
+    Graph H;
+    FlatDiagram fd = load_diagram(path, &H);
+    int m = G.n_items();
+    assert(unfold_flat_diagram(m, fd, true) == unfold_ddstructure(m, dd, true));
+
+    // the item layout survives
+    assert(H.n_items() == m);
+    assert(H.max_frontier_size() == G.max_frontier_size());
+    assert(H.edge_order() == G.edge_order());
+    for (int v : G.vertices()) {
+        assert(H.var_of_vertex(v) == G.var_of_vertex(v));
+        assert(H.frontier_index(v) == G.frontier_index(v));
+    }
+    for (int i = 0; i < m; ++i) {
+        assert(H.item_v0(i) == G.item_v0(i) and H.item_v1(i) == G.item_v1(i));
+        assert(H.item_multiplicity(i) == G.item_multiplicity(i));
+    }
+
+    // evaluators run on the mapped diagram
+    vector<int> cost(m);
+    for (int i = 0; i < m; ++i) cost[i] = (i * 37) % 11;
+    LinearOptimization<int> opt, opt_mapped;
+    opt.set_dd(dd);
+    opt_mapped.set_diagram(fd);
+    assert(opt.optimize(cost) == opt_mapped.optimize(cost));
+    vector<double> ones(m, 1.0);
+    double count = evaluate_semiring<SumProduct<double>>(fd, {}, ones);
+    assert(to_string((long long)count) == dd.zddCardinality());
+    cout << count << " " << opt_mapped.optimize(cost).first << endl;
+
+    // corrupted files are rejected
+    string bytes;
+    {
+        ifstream is(path, ios::binary);
+        bytes.assign(istreambuf_iterator<char>(is), istreambuf_iterator<char>());
+    }
+    DiagramFileHeader h;
+    memcpy(&h, bytes.data(), sizeof(h));
+    auto patch = [&](size_t pos, uint64_t x, size_t width) {
+        string b = bytes;
+        memcpy(&b[pos], &x, width);
+        return b;
+    };
+    auto field = [&](uint64_t DiagramFileHeader::* f, uint64_t x) {
+        return patch((char*)&(h.*f) - (char*)&h, x, sizeof(uint64_t));
+    };
+    size_t top = h.offset_pos + 8 * (h.top_level + 1);
+    size_t last_child = h.child_pos + 4 * 2 * (h.n_nodes - 1);
+    vector<string> broken = {
+        bytes.substr(0, h.graph_pos + h.graph_size - 1),
+        field(&DiagramFileHeader::root, h.n_nodes),
+        field(&DiagramFileHeader::top_level, ~0ULL - 1),
+        field(&DiagramFileHeader::n_nodes, ~0ULL / 8),
+        field(&DiagramFileHeader::child_pos, ~0ULL - 7),
+        field(&DiagramFileHeader::graph_size, ~0ULL),
+        patch(h.offset_pos, 1, 8),
+        patch(h.offset_pos + 16, h.n_nodes + 1, 8),
+        patch(top, h.n_nodes - 1, 8),
+        patch(last_child, h.n_nodes - 1, 4),
+        patch(h.child_pos + 8 * 2, ~0U, 4),
+    };
+    int n_rejected = 0;
+    for (const string& b : broken) {
+        {
+            ofstream os(path, ios::binary);
+            os.write(b.data(), b.size());
+        }
+        try {
+            Graph K;
+            load_diagram(path, &K);
+        }
+        catch (const runtime_error&) {
+            ++n_rejected;
+        }
+    }
+    assert(n_rejected == (int)broken.size());
+    remove(path.c_str());
+
+    // so are inconsistent graph sections: the arrays of write_binary
+    // (vertices, edge_v0, edge_v1, order, it_v0, it_v1, it_mult, it_orig,
+    // v_to_item, e_to_item, f_index, max_f_size) with one of them broken
+    vector<vector<int>> arrays;
+    {
+        ostringstream os;
+        G.write_binary(os);
+        istringstream is(os.str());
+        uint64_t size;
+        while (is.read((char*)&size, sizeof(size))) {
+            arrays.emplace_back(size);
+            is.read((char*)arrays.back().data(), sizeof(int) * size);
+        }
+    }
+    assert(arrays.size() == 12);
+    auto serialize = [](const vector<vector<int>>& a) {
+        ostringstream os;
+        for (const vector<int>& v : a) {
+            uint64_t size = v.size();
+            os.write((const char*)&size, sizeof(size));
+            os.write((const char*)v.data(), sizeof(int) * size);
+        }
+        return os.str();
+    };
+    int n = G.max_vertex_number() + 1;
+    vector<function<void(vector<vector<int>>&)>> breaks = {
+        [&](auto& a) { a[0][0] = -1; },
+        [&](auto& a) { a[1][0] = n + 3; },
+        [&](auto& a) { a[2][0] = a[1][0]; },
+        [&](auto& a) { a[3][0] = G.n_edges(); },
+        [&](auto& a) { a[3].pop_back(); },
+        [&](auto& a) { a[4][0] = -2; },
+        [&](auto& a) { a[5][0] = n; },
+        [&](auto& a) { a[7][0] = G.n_edges() + n; },
+        [&](auto& a) { a[8].pop_back(); },
+        [&](auto& a) { a[9].push_back(0); },
+        [&](auto& a) { a[9][0] = G.n_items(); },
+        [&](auto& a) { a[10][0] = n; },
+        [&](auto& a) { a[11][0] += 1; },
+        [&](auto& a) { a.resize(11); },
+    };
+    Graph K;
+    {
+        istringstream is(serialize(arrays));
+        assert(K.read_binary(is));
+    }
+    for (auto& f : breaks) {
+        vector<vector<int>> a = arrays;
+        f(a);
+        istringstream is(serialize(a));
+        assert(not K.read_binary(is));
+    }
+    // so does a huge vertex number that the other arrays do not cover
+    {
+        vector<vector<int>> a(12);
+        a[0] = {1500000000};
+        a[11] = {0};
+        istringstream is(serialize(a));
+        assert(not K.read_binary(is));
+    }
+    // a huge array size at the end of input fails without allocating it
+    {
+        uint64_t size = 1ULL << 30;
+        istringstream is(string((const char*)&size, sizeof(size)));
+        assert(not K.read_binary(is));
+    }
+}
+
+void test_memory_manager() {
+    cout << "Test memory manager" << endl;
+    SapporoMemoryManager& memory = SapporoMemoryManager::instance();
+
+    // nothing creates ZBDD nodes before init or attach
+    bool refused = false;
+    try {
+        check_sapporo_vars(1);
+    }
+    catch (const runtime_error&) {
+        refused = true;
+    }
+    assert(refused and BDD_VarUsed() == 0);
+    memory.init(1000000, 10000);
+    assert(memory.limit_nodes() == 1000000);
+
+    Graph G = make_grid_graph(4);
+    DdStructure<2> dd = tdzdd_spanning_trees(G, true);
+    check_sapporo_vars(dd.topLevel());
+    ZBDD f = to_zbdd(dd);
+    assert(memory.peak_nodes() > 0);
+    assert(memory.peak_nodes() <= memory.limit_nodes());
+
+    // a request beyond the budget fails before creating any node
+    bool failed = false;
+    try {
+        memory.reserve(memory.limit_nodes() + 1, "test");
+    }
+    catch (const runtime_error& e) {
+        failed = true;
+        cout << e.what() << endl;
+    }
+    assert(failed);
+    cout << f.Card() << endl;
+}
+
+void test_build_stats() {
+    cout << "Test build statistics" << endl;
+    Graph G = make_grid_graph(3);
+    BuildStats stats;
+    DdStructure<2> dd = tdzdd_st_paths(G, 0, 8, false, false, &stats);
+    assert(stats.reduced_nodes() == dd.size());
+    assert(stats.unreduced_nodes() >= stats.reduced_nodes());
+    assert(stats.state_bytes > 0);
+    assert((int)stats.frontier_size.size() == G.n_items());
+    int max_f = *max_element(stats.frontier_size.begin(), stats.frontier_size.end());
+    assert(max_f <= G.max_frontier_size());
+    for (size_t i = 0; i < stats.reduced_width.size(); ++i) {
+        assert(stats.reduced_width[i] <= stats.unreduced_width[i]);
+    }
+
+    // builders without a graph leave frontier_size empty
+    vector<vector<int>> A = {{1, 2, 3}};
+    DdStructure<2> ineq = tdzdd_linear_inequalities(A, {"<="}, {3}, false, &stats);
+    assert(stats.frontier_size.empty());
+    assert(stats.reduced_nodes() == ineq.size());
+    cout << stats.to_json() << endl;
+}
+
+void test_instance_loader() {
+    cout << "Test instance loader" << endl;
+    ifstream graph_in("dataset/sample_graph.txt");
+    string keyword;
+    graph_in >> keyword;
+    Graph G = read_graph(graph_in);
+    Graph H = load_graph("dataset/sample_graph.txt");
+    auto same_graph = [&](const Graph& X) {
+        assert(X.n_edges() == G.n_edges() and X.n_items() == G.n_items());
+        for (int i = 0; i < G.n_edges(); ++i) assert(X.edge(i) == G.edge(i));
+        for (int i = 0; i < G.n_items(); ++i) {
+            assert(X.item_v0(i) == G.item_v0(i) and X.item_v1(i) == G.item_v1(i));
+        }
+    };
+    same_graph(H);
+    save_graph_binary("test_graph.bin", G);
+    same_graph(load_graph("test_graph.bin"));
+
+    ifstream ineq_in("dataset/sample_inequalities.txt");
+    ineq_in >> keyword;
+    LinearInequalities instance = read_linear_inequalities(ineq_in);
+    LinearSystem sys = load_linear_system("dataset/sample_inequalities.txt");
+    auto same_system = [&](const LinearSystem& X) {
+        assert(X.n_vars == instance.n_vars and X.A.n_cols == instance.n_vars);
+        assert(X.dense_A() == instance.A);
+        assert(X.sign == instance.sign and X.b == instance.b);
+    };
+    same_system(sys);
+    save_linear_system_binary("test_system.bin", sys);
+    same_system(load_linear_system("test_system.bin"));
+
+    // a sparse system loads in O(nnz), whatever n_vars is
+    LinearSystem wide;
+    wide.n_vars = 1 << 28;
+    wide.A.n_rows = 2;
+    wide.A.n_cols = wide.n_vars;
+    wide.A.row_ptr = {0, 2, 3};
+    wide.A.col_index = {5, wide.n_vars - 1, 7};
+    wide.A.value = {1, -2, 3};
+    wide.sign = {"<=", ">="};
+    wide.b = {1, 0};
+    save_linear_system_binary("test_system.bin", wide);
+    LinearSystem wide2 = load_linear_system("test_system.bin");
+    assert(wide2.n_vars == wide.n_vars and wide2.A.col_index == wide.A.col_index);
+    assert(wide2.A.row_ptr == wide.A.row_ptr and wide2.A.value == wide.A.value);
+
+    // broken input is reported, not misread
+    // (and sizes in the header are not trusted for allocation)
+    auto expect_broken = [](const string& bytes, bool graph) {
+        {
+            ofstream os("test_broken.txt", ios::binary);
+            os << bytes;
+        }
+        bool failed = false;
+        try {
+            if (graph) load_graph("test_broken.txt");
+            else load_linear_system("test_broken.txt");
+        }
+        catch (const runtime_error& e) {
+            failed = true;
+            cout << e.what() << endl;
+        }
+        assert(failed);
+    };
+    for (string text : {
+        "graph 3 2\n0 1\n1 x\n",
+        "graph 3 2\n0 1\n1 2abc\n",
+        "graph 3 2\n0 1\n1 2.5\n",
+        "5 400000000\n0 1\n",
+        "3 1\n0 1500000000\n",
+    }) {
+        expect_broken(text, true);
+    }
+    expect_broken("ineq 3 400000000\n1 1 1 <= 2\n", false);
+    {
+        // a binary graph with a vertex beyond its vertex count
+        save_graph_binary("test_graph.bin", G);
+        ifstream is("test_graph.bin", ios::binary);
+        string bytes((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
+        uint64_t n_cols = 1;
+        memcpy(&bytes[offsetof(InstanceFileHeader, n_cols)], &n_cols, sizeof(n_cols));
+        expect_broken(bytes, true);
+    }
+    for (const char* path : {"test_graph.bin", "test_system.bin", "test_broken.txt"}) {
+        remove(path);
+    }
+    cout << G.n_edges() << " edges, " << sys.A.n_rows << " inequalities" << endl;
+}
+
+void test_path_cycle_specs() {
+    cout << "Test path and cycle specs" << endl;
+    mt19937 rng(2024);
+    int n_cases = 0;
+    for (int seed = 0; seed < 60; ++seed) {
+        // small multigraphs with a random edge order
+        int n = 3 + seed % 4, m = n + seed % 7;
+        Graph G = make_random_multigraph(n, m, rng);
+        uniform_int_distribution<int> vertex(0, n - 1);
+
+        int k = G.n_items();
+        for (int wv = 0; wv < 2; ++wv) {
+            int s = vertex(rng), t = vertex(rng);
+            DdStructure<2> paths = tdzdd_st_paths(G, s, t, wv);
+            assert(unfold_ddstructure(k, paths, true) == naive_st_paths(G, s, t, wv));
+            // s == t gives the paths with s as one end
+            DdStructure<2> ends = tdzdd_st_paths(G, s, s, wv);
+            vector<vector<int>> ends_ans = naive_st_paths(G, s, s, wv);
+            assert(not ends_ans.empty());
+            assert(unfold_ddstructure(k, ends, true) == ends_ans);
+            DdStructure<2> cycles = tdzdd_cycles(G, wv);
+            assert(unfold_ddstructure(k, cycles, true) == naive_cycles(G, wv));
+            ++n_cases;
+        }
+    }
+    cout << n_cases << " cases" << endl;
+}
+
+void test_degree_specs() {
+    cout << "Test degree specs" << endl;
+    mt19937 rng(2025);
+    int n_cases = 0;
+    for (int seed = 0; seed < 60; ++seed) {
+        int n = 3 + seed % 4, m = n + seed % 8;
+        Graph G = make_random_multigraph(n, m, rng);
+        int k = G.n_items();
+
+        // random ranges lb <= deg <= ub
+        vector<int> lb(n), ub(n);
+        for (int v = 0; v < n; ++v) {
+            lb[v] = uniform_int_distribution<int>(0, 2)(rng);
+            ub[v] = lb[v] + uniform_int_distribution<int>(0, 2)(rng);
+        }
+        auto in_range = [&](int v, int d) { return lb[v] <= d and d <= ub[v]; };
+
+        // sparse candidate sets such as {0, 3}
+        vector<set<int>> cand(n);
+        for (int v = 0; v < n; ++v) {
+            for (int d = 0; d <= 5; ++d) {
+                if (bernoulli_distribution(0.35)(rng)) cand[v].insert(d);
+            }
+        }
+        cand[0] = {0, 3};
+        auto in_cand = [&](int v, int d) { return cand[v].count(d) > 0; };
+
+        for (int wv = 0; wv < 2; ++wv) {
+            DdStructure<2> range = tdzdd_degree_constraints(G, lb, ub, wv);
+            assert(unfold_ddstructure(k, range, true)
+                   == naive_degree_subgraphs(G, in_range, wv));
+
+            DegreeSpec<int> spec(G, cand, wv);
+            DdStructure<2> deg(spec);
+            deg.zddReduce();
+            assert(unfold_ddstructure(k, deg, true)
+                   == naive_degree_subgraphs(G, in_cand, wv));
+            ++n_cases;
+        }
+    }
+    cout << n_cases << " cases" << endl;
 }
 
 int main(int argc, char* argv[]) {
-    bddinit(10000, 1000000);
     MessageHandler::showMessages();
     string test_type(argv[1]);
+    // -memory starts from an unmanaged SAPPOROBDD
+    if (test_type != "-memory") SapporoMemoryManager::instance().init(1000000, 10000);
 
     if (test_type == "-power") test_powerset();
     if (test_type == "-subset") test_subset();
@@ -170,4 +836,17 @@ int main(int argc, char* argv[]) {
     if (test_type == "-path") test_path_enumeration();
     if (test_type == "-cycle") test_cycle_enumeration();
     if (test_type == "-linear") test_linear_optimization();
+    if (test_type == "-stream") test_streaming();
+    if (test_type == "-order") test_edge_ordering();
+    if (test_type == "-ineq") test_linear_inequalities();
+    if (test_type == "-ranked") test_ranked_enumeration();
+    if (test_type == "-semiring") test_semiring();
+    if (test_type == "-batch") test_batch_optimization();
+    if (test_type == "-sample") test_sampling();
+    if (test_type == "-persist") test_persistence();
+    if (test_type == "-memory") test_memory_manager();
+    if (test_type == "-stats") test_build_stats();
+    if (test_type == "-load") test_instance_loader();
+    if (test_type == "-simpath") test_path_cycle_specs();
+    if (test_type == "-degree") test_degree_specs();
 }
\ No newline at end of file